@@ -0,0 +1,41 @@
+#include "arena.h"
+
+#include <string.h>
+
+#include "logger.h"
+
+static _Alignas(16) char arena[ARENA_SIZE];
+static size_t used;
+static size_t high_water;
+static size_t overflows;
+
+void *arena_alloc(size_t size) {
+    size_t start = (used + 7) & ~(size_t)7;
+    if (size > ARENA_SIZE || start > ARENA_SIZE - size) {
+        overflows++;
+        fs_error("arena: overflow, used %zu, request %zu\n", used, size);
+        return NULL;
+    }
+    used = start + size;
+    if (used > high_water) high_water = used;
+    return arena + start;
+}
+
+char *arena_strdup(const char *s) {
+    size_t len = strlen(s) + 1;
+    char *p = arena_alloc(len);
+    if (p) memcpy(p, s, len);
+    return p;
+}
+
+void arena_reset(void) {
+    used = 0;
+}
+
+size_t arena_high_water(void) {
+    return high_water;
+}
+
+size_t arena_overflows(void) {
+    return overflows;
+}
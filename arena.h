@@ -0,0 +1,24 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// 每个 FUSE 回调可用的临时内存上限
+#define ARENA_SIZE (64 * 1024)
+
+// 从请求级 arena 中分配 size 字节（8 字节对齐），空间不足时返回 NULL
+void *arena_alloc(size_t size);
+
+// 把字符串复制到 arena 中，空间不足时返回 NULL
+char *arena_strdup(const char *s);
+
+// 回收本次请求分配的全部内存，每个 FUSE 回调开始时调用
+void arena_reset(void);
+
+// 历史上单个请求用到的最大字节数
+size_t arena_high_water(void);
+
+// 因空间不足而失败的分配次数
+size_t arena_overflows(void);
+
+#endif
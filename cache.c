@@ -0,0 +1,303 @@
+#include "cache.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+
+#include "crc32c.h"
+#include "heat.h"
+#include "logger.h"
+
+// 换出时在 LRU 尾部向前查找干净块的范围
+#define EVICT_SCAN 64
+// 连续这么多次换出跳过了脏块后，下一次数据缺失时顺带写回一批最旧的脏块
+#define STARVE_LIMIT 16
+// 元数据读也推迟不了的上限，防止只有元数据请求时脏块永远留在缓存里
+#define STARVE_HARD_LIMIT (4 * STARVE_LIMIT)
+#define FLUSH_BATCH 32
+
+// 缺失的类别：同步的元数据读优先级最高，数据读写其次，脏块写回作为后台任务排在最后
+typedef enum io_class {
+    IO_META,
+    IO_DATA,
+} io_class_t;
+
+static buf_t bufs[CACHE_BLOCKS];
+// 块号到缓存槽的直接映射，-1 表示不在缓存中
+static int slot_of[BLOCK_NUM];
+// LRU 链表，head 为最近使用，tail 为最久未使用
+static buf_t *lru_head, *lru_tail;
+static uint64_t checksum_errors;
+// 连续跳过脏块的换出次数
+static int deferred;
+
+// 缺失延迟的直方图，第 i 个桶记录 [2^i, 2^(i+1)) 纳秒
+#define LATENCY_BUCKETS 40
+static struct {
+    uint64_t misses;
+    uint64_t forced;            // 找不到干净块，只能先同步写回脏块
+    uint64_t hist[LATENCY_BUCKETS];
+} class_stats[2];
+static uint64_t background_batches, background_blocks;
+
+static int budget;          // 0 表示不限制
+static int budget_used;
+static uint64_t budget_denied;
+
+void block_seal(void *data) {
+    uint32_t crc = crc32c(0, data, BLOCK_SIZE - CHECKSUM_SIZE);
+    memcpy((char *)data + BLOCK_SIZE - CHECKSUM_SIZE, &crc, CHECKSUM_SIZE);
+}
+
+static bool block_verify(const void *data) {
+    uint32_t crc;
+    memcpy(&crc, (const char *)data + BLOCK_SIZE - CHECKSUM_SIZE, CHECKSUM_SIZE);
+    return crc == crc32c(0, data, BLOCK_SIZE - CHECKSUM_SIZE);
+}
+
+uint64_t cache_checksum_errors(void) {
+    return checksum_errors;
+}
+
+static void lru_unlink(buf_t *b) {
+    if (b->prev) b->prev->next = b->next; else lru_head = b->next;
+    if (b->next) b->next->prev = b->prev; else lru_tail = b->prev;
+    b->prev = b->next = NULL;
+}
+
+static void lru_push_front(buf_t *b) {
+    b->prev = NULL;
+    b->next = lru_head;
+    if (lru_head) lru_head->prev = b; else lru_tail = b;
+    lru_head = b;
+}
+
+static int write_back(buf_t *b) {
+    if (!b->dirty) return 0;
+    if (b->meta) block_seal(b->data);
+    heat_write(b->block);
+    if (disk_write(b->block, b->data) != 0) {
+        fs_error("cache: write back block %d failed\n", b->block);
+        return -1;
+    }
+    b->dirty = false;
+    return 0;
+}
+
+void cache_init(void) {
+    for (int i = 0; i < BLOCK_NUM; ++i) slot_of[i] = -1;
+    lru_head = lru_tail = NULL;
+    for (int i = 0; i < CACHE_BLOCKS; ++i) {
+        bufs[i].block = -1;
+        bufs[i].pin = 0;
+        bufs[i].dirty = false;
+        bufs[i].meta = false;
+        bufs[i].prev = bufs[i].next = NULL;
+        lru_push_front(&bufs[i]);
+    }
+}
+
+static buf_t *take(buf_t *b) {
+    if (b->block >= 0) slot_of[b->block] = -1;
+    b->block = -1;
+    b->meta = false;
+    return b;
+}
+
+// 后台写回：从 LRU 尾部开始写回至多 FLUSH_BATCH 个没有被钉住的脏块
+//
+// 只有真正写回了脏块才重新计数，预算用完或写回失败时计数保持不变，下一次缺失再试
+static void flush_background(void) {
+    int n = 0;
+    for (buf_t *b = lru_tail; b && n < FLUSH_BATCH; b = b->prev) {
+        if (b->pin > 0 || !b->dirty) continue;
+        if (!cache_budget_take() || write_back(b) != 0) break;
+        n++;
+    }
+    if (n == 0) return;
+    background_batches++;
+    background_blocks += n;
+    deferred = 0;
+}
+
+// 从 LRU 尾部找一个没有被钉住的槽
+//
+// 优先取干净的块，缺失的读不必先等脏块写回；被跳过的脏块由数据类的缺失分批写回，
+// 元数据读只有在跳过次数超过硬上限或者附近没有干净块时才会写回
+static buf_t *evict(io_class_t cls) {
+    buf_t *oldest_dirty = NULL;
+    int scanned = 0;
+    for (buf_t *b = lru_tail; b && scanned < EVICT_SCAN; b = b->prev) {
+        if (b->pin > 0) continue;
+        scanned++;
+        if (!b->dirty) {
+            if (oldest_dirty != NULL) deferred++;
+            if (deferred >= STARVE_HARD_LIMIT || (cls == IO_DATA && deferred >= STARVE_LIMIT)) {
+                flush_background();
+            }
+            return take(b);
+        }
+        if (oldest_dirty == NULL) oldest_dirty = b;
+    }
+    if (oldest_dirty == NULL) {
+        fs_error("cache: all %d blocks are pinned\n", CACHE_BLOCKS);
+        return NULL;
+    }
+    class_stats[cls].forced++;
+    if (write_back(oldest_dirty) != 0) return NULL;
+    return take(oldest_dirty);
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void record_miss(io_class_t cls, uint64_t ns) {
+    int i = 0;
+    while (i < LATENCY_BUCKETS - 1 && ns >= (2ULL << i)) i++;
+    class_stats[cls].misses++;
+    class_stats[cls].hist[i]++;
+}
+
+static buf_t *lookup(int block, bool load, io_class_t cls) {
+    if (block < 0 || block >= BLOCK_NUM) return NULL;
+
+    buf_t *b;
+    if (slot_of[block] >= 0) {
+        b = &bufs[slot_of[block]];
+    } else {
+        uint64_t start = now_ns();
+        b = evict(cls);
+        if (b == NULL) return NULL;
+        if (load) {
+            heat_read(block);
+            if (disk_read(block, b->data) != 0) return NULL;
+        }
+        b->block = block;
+        slot_of[block] = b - bufs;
+        record_miss(cls, now_ns() - start);
+    }
+    lru_unlink(b);
+    lru_push_front(b);
+    b->pin++;
+    return b;
+}
+
+buf_t *cache_get(int block) {
+    return lookup(block, true, IO_DATA);
+}
+
+buf_t *cache_get_meta(int block) {
+    buf_t *b = lookup(block, true, IO_META);
+    if (b == NULL || b->meta) return b;
+    if (!block_verify(b->data)) {
+        checksum_errors++;
+        fs_error("cache: checksum mismatch on block %d\n", block);
+        b->pin--;
+        return NULL;
+    }
+    b->meta = true;
+    return b;
+}
+
+void cache_mark_meta(buf_t *b) {
+    b->meta = true;
+}
+
+buf_t *cache_get_zeroed(int block) {
+    buf_t *b = lookup(block, false, IO_DATA);
+    if (b == NULL) return NULL;
+    memset(b->data, 0, BLOCK_SIZE);
+    b->dirty = true;
+    b->meta = false;
+    return b;
+}
+
+bool cache_contains(int block) {
+    return block >= 0 && block < BLOCK_NUM && slot_of[block] >= 0;
+}
+
+void cache_mark_dirty(buf_t *b) {
+    b->dirty = true;
+}
+
+void cache_put(buf_t *b) {
+    if (b == NULL) return;
+    if (b->pin <= 0) {
+        fs_error("cache: put on unpinned block %d\n", b->block);
+        return;
+    }
+    b->pin--;
+}
+
+void cache_prefetch(const int *blocks, int n) {
+    int loaded = 0;
+    for (int i = 0; i < n && loaded < CACHE_BLOCKS / 2; ++i) {
+        if (blocks[i] < 0 || blocks[i] >= BLOCK_NUM || slot_of[blocks[i]] >= 0) continue;
+        if (!cache_budget_take()) return;
+        buf_t *b = cache_get(blocks[i]);
+        if (b == NULL) return;
+        cache_put(b);
+        loaded++;
+    }
+}
+
+int cache_sync(int block) {
+    if (!cache_contains(block)) return 0;
+    return write_back(&bufs[slot_of[block]]);
+}
+
+// 直方图中第 q 分位所在桶的上界
+static uint64_t percentile(const uint64_t *hist, uint64_t total, double q) {
+    uint64_t want = (uint64_t)(q * total), seen = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; ++i) {
+        seen += hist[i];
+        if (seen > want) return 2ULL << i;
+    }
+    return 2ULL << (LATENCY_BUCKETS - 1);
+}
+
+void cache_set_budget(int n) {
+    budget = n;
+}
+
+void cache_request_begin(void) {
+    budget_used = 0;
+}
+
+bool cache_budget_take(void) {
+    if (budget == 0) return true;
+    if (budget_used >= budget) {
+        budget_denied++;
+        return false;
+    }
+    budget_used++;
+    return true;
+}
+
+void cache_report(void) {
+    static const char *names[] = {"meta", "data"};
+    for (int c = 0; c < 2; ++c) {
+        uint64_t n = class_stats[c].misses;
+        fs_important("cache: %s misses %llu, forced write-backs %llu, p50 < %llu ns, p99 < %llu ns\n", names[c],
+                     (unsigned long long)n, (unsigned long long)class_stats[c].forced,
+                     (unsigned long long)(n ? percentile(class_stats[c].hist, n, 0.5) : 0),
+                     (unsigned long long)(n ? percentile(class_stats[c].hist, n, 0.99) : 0));
+    }
+    fs_important("cache: %llu background write-back batches, %llu blocks\n",
+                 (unsigned long long)background_batches, (unsigned long long)background_blocks);
+    if (budget > 0) {
+        fs_important("cache: budget %d per request, %llu deferrable operations postponed or dropped\n", budget,
+                     (unsigned long long)budget_denied);
+    }
+}
+
+int cache_flush(void) {
+    int ret = 0;
+    for (int i = 0; i < CACHE_BLOCKS; ++i) {
+        if (bufs[i].block >= 0 && write_back(&bufs[i]) != 0) ret = -1;
+    }
+    return ret;
+}
@@ -0,0 +1,86 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "disk.h"
+
+// 缓存中最多同时驻留的块数（8 MiB）
+#define CACHE_BLOCKS 2048
+
+// 缺失时按类别区别对待：元数据读（cache_get_meta）最优先，换出时不会先等脏数据写回；
+// 数据读写（cache_get、cache_get_zeroed）其次；脏块写回是后台任务，
+// 由数据类的缺失分批完成，并且推迟的次数有上限
+
+// 元数据块（超级块、位图、inode 表、目录块）的最后 CHECKSUM_SIZE 字节
+// 存放前面内容的 CRC32C，块第一次作为元数据被访问时校验，写回磁盘前重新计算
+#define CHECKSUM_SIZE 4
+
+// 块缓存句柄
+//
+// cache_get 返回的句柄在 cache_put 之前一直被钉住（pin），不会被换出，
+// 调用者可以直接在 data 上原地读写，修改后用 cache_mark_dirty 标记
+typedef struct buf {
+    int block;           // 对应的磁盘块号，-1 表示空槽
+    int pin;             // 引用计数，大于 0 时不可换出
+    bool dirty;          // 是否需要写回磁盘
+    bool meta;           // 是否是已校验过的元数据块，写回时需要重新计算校验和
+    struct buf *prev;    // LRU 链表，表头为最近使用
+    struct buf *next;
+    char data[BLOCK_SIZE];
+} buf_t;
+
+// 初始化缓存，挂载时调用一次
+void cache_init(void);
+
+// 获取 block 对应的缓存块并钉住，必要时从磁盘读入，失败返回 NULL
+buf_t *cache_get(int block);
+
+// 和 cache_get 相同，但按元数据块访问：第一次访问时校验，校验失败返回 NULL
+buf_t *cache_get_meta(int block);
+
+// 把新建的块（通常来自 cache_get_zeroed）标记为元数据块
+void cache_mark_meta(buf_t *b);
+
+// 计算 data 的校验和并写入其末尾，用于绕过缓存直接写盘的元数据块
+void block_seal(void *data);
+
+// 校验失败的次数
+uint64_t cache_checksum_errors(void);
+
+// 获取一个新分配的块并钉住，不读磁盘，内容清零并标记为脏
+buf_t *cache_get_zeroed(int block);
+
+// block 当前是否在缓存中
+bool cache_contains(int block);
+
+// 标记句柄对应的块已被修改
+void cache_mark_dirty(buf_t *b);
+
+// 释放 cache_get 得到的句柄
+void cache_put(buf_t *b);
+
+// 批量预读 blocks 中尚未缓存的块（不钉住），最多预读缓存容量的一半
+void cache_prefetch(const int *blocks, int n);
+
+// 如果 block 在缓存中且是脏的，立即写回磁盘，成功（或无需写回）返回 0
+int cache_sync(int block);
+
+// 把所有脏块写回磁盘，成功返回 0
+int cache_flush(void);
+
+// 受限延迟模式：每个请求最多做 budget 次可推迟的工作（预读、后台写回、后台释放的块），
+// 0 表示不限制。超出预算的预读被放弃，写回和释放留给之后的请求
+void cache_set_budget(int budget);
+
+// 每个请求开始时调用，重新计算预算
+void cache_request_begin(void);
+
+// 消耗一个单位的预算，预算用完时返回 false
+bool cache_budget_take(void);
+
+// 输出按类别（元数据 / 数据）统计的缺失次数、延迟分位数和后台写回次数
+void cache_report(void);
+
+#endif
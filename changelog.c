@@ -0,0 +1,91 @@
+#include "changelog.h"
+
+#include <string.h>
+#include <time.h>
+
+#include "cache.h"
+
+#define CHANGES_PER_BLOCK ((BLOCK_SIZE - CHECKSUM_SIZE) / sizeof(struct fslab_change))
+
+static int log_start, log_blocks;
+static uint64_t capacity;
+static uint64_t next_seq;       // 下一条记录的序号
+static uint64_t read_high;      // 已经返回给读者的最大序号，之后的记录不能再合并
+static uint32_t last_ino, last_op;
+
+// 序号为 seq 的记录所在的块和块内位置
+static int slot_of(uint64_t seq, int *index) {
+    uint64_t slot = (seq - 1) % capacity;
+    *index = slot % CHANGES_PER_BLOCK;
+    return log_start + slot / CHANGES_PER_BLOCK;
+}
+
+void changelog_open(int start, int blocks) {
+    log_start = start;
+    log_blocks = blocks;
+    capacity = (uint64_t)blocks * CHANGES_PER_BLOCK;
+    next_seq = 1;
+    read_high = 0;
+    last_ino = last_op = 0;
+    for (int i = 0; i < blocks; ++i) {
+        buf_t *bh = cache_get_meta(start + i);
+        if (bh == NULL) continue;
+        const struct fslab_change *c = (const struct fslab_change *)bh->data;
+        for (size_t j = 0; j < CHANGES_PER_BLOCK; ++j) {
+            if (c[j].seq >= next_seq) {
+                next_seq = c[j].seq + 1;
+                last_ino = c[j].ino;
+                last_op = c[j].op;
+            }
+        }
+        cache_put(bh);
+    }
+    // 重新挂载之前的记录可能已经被读过
+    read_high = next_seq - 1;
+}
+
+bool changelog_enabled(void) {
+    return log_blocks > 0;
+}
+
+void changelog_append(uint32_t ino, uint32_t parent, uint32_t op) {
+    if (log_blocks == 0) return;
+    if (op == FSLAB_CHANGE_WRITE && last_op == op && last_ino == ino && read_high < next_seq - 1) return;
+
+    int index;
+    buf_t *bh = cache_get_meta(slot_of(next_seq, &index));
+    if (bh == NULL) return;
+    ((struct fslab_change *)bh->data)[index] = (struct fslab_change){
+        .seq = next_seq,
+        .ino = ino,
+        .parent = parent,
+        .op = op,
+        .time = (uint32_t)time(NULL),
+    };
+    cache_mark_dirty(bh);
+    cache_put(bh);
+    next_seq++;
+    last_ino = ino;
+    last_op = op;
+}
+
+void changelog_read(struct fslab_change_query *q) {
+    uint64_t oldest = next_seq > capacity ? next_seq - capacity : 1;
+    uint64_t seq = q->cursor + 1;
+    q->count = 0;
+    q->flags = 0;
+    q->head = next_seq - 1;
+    if (seq < oldest) {
+        q->flags |= FSLAB_CHANGES_LOST;
+        seq = oldest;
+    }
+    for (; seq < next_seq && q->count < FSLAB_CHANGE_MAX; ++seq) {
+        int index;
+        buf_t *bh = cache_get_meta(slot_of(seq, &index));
+        if (bh == NULL) break;
+        q->changes[q->count++] = ((const struct fslab_change *)bh->data)[index];
+        cache_put(bh);
+        q->cursor = seq;
+    }
+    if (q->cursor > read_high) read_high = q->cursor;
+}
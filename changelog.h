@@ -0,0 +1,28 @@
+#ifndef CHANGELOG_H
+#define CHANGELOG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "fslab_ioctl.h"
+
+// 变更日志
+//
+// 格式化时带 --change-log 会在元数据区之后预留 CHANGE_LOG_BLOCKS 个块，作为环形日志
+// 按顺序记录创建、删除、改名、写和截断（struct fslab_change），写满后覆盖最旧的记录。
+// 日志块是元数据块，经过缓存并带校验和；序号从 1 开始递增，挂载时扫描日志块恢复。
+// 同步工具通过 FSLAB_IOC_READ_CHANGES 从上一次的游标开始读，只处理这之后的变更
+#define CHANGE_LOG_BLOCKS 64
+
+// 挂载时调用，blocks 为 0 表示没有日志
+void changelog_open(int start, int blocks);
+
+bool changelog_enabled(void);
+
+// 追加一条记录，op 为 FSLAB_CHANGE_*；同一个文件连续的写只记一次，除非上一条已经被读走
+void changelog_append(uint32_t ino, uint32_t parent, uint32_t op);
+
+// 读取游标 q->cursor 之后的记录，更新 q->cursor 为最后一条返回的序号
+void changelog_read(struct fslab_change_query *q);
+
+#endif
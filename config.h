@@ -8,4 +8,7 @@
 
 #ifndef _POSIX_C_SOURCE
 #define _POSIX_C_SOURCE 200809L
-#endif
\ No newline at end of file
+#endif
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // O_DIRECT, RUSAGE_THREAD
+#endif
@@ -0,0 +1,62 @@
+#include "crc32c.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#define CRC32C_POLY 0x82f63b78u
+
+static uint32_t table[256];
+static bool table_ready;
+
+static void build_table(void) {
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k) {
+            c = (c & 1) ? (c >> 1) ^ CRC32C_POLY : c >> 1;
+        }
+        table[i] = c;
+    }
+    table_ready = true;
+}
+
+static uint32_t crc32c_table(uint32_t crc, const unsigned char *p, size_t len) {
+    if (!table_ready) build_table();
+    while (len--) {
+        crc = table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42(uint32_t crc, const unsigned char *p, size_t len) {
+    uint64_t c = crc;
+    while (len >= 8) {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        c = __builtin_ia32_crc32di(c, v);
+        p += 8;
+        len -= 8;
+    }
+    uint32_t c32 = (uint32_t)c;
+    while (len--) {
+        c32 = __builtin_ia32_crc32qi(c32, *p++);
+    }
+    return c32;
+}
+#endif
+
+uint32_t crc32c(uint32_t crc, const void *buf, size_t len) {
+    crc = ~crc;
+#if defined(__x86_64__)
+    static int has_sse42 = -1;
+    if (has_sse42 < 0) {
+        __builtin_cpu_init();
+        has_sse42 = __builtin_cpu_supports("sse4.2");
+    }
+    if (has_sse42) {
+        return ~crc32c_sse42(crc, buf, len);
+    }
+#endif
+    return ~crc32c_table(crc, buf, len);
+}
@@ -0,0 +1,12 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 计算 CRC32C（Castagnoli）校验和，crc 传入上一段的结果以便分段计算，首段传 0
+//
+// 支持 SSE4.2 的 x86-64 处理器上使用 crc32 指令，否则使用查表实现
+uint32_t crc32c(uint32_t crc, const void *buf, size_t len);
+
+#endif
@@ -0,0 +1,139 @@
+#include "dirsnap.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ebr.h"
+
+#define RECORD_HEADER 6
+
+static dirsnap_t snaps[DIRSNAP_SLOTS];
+static uint64_t use_clock;
+
+dirsnap_t *dirsnap_get(uint32_t dir) {
+    for (int i = 0; i < DIRSNAP_SLOTS; ++i) {
+        if (snaps[i].used && snaps[i].dir == dir) {
+            snaps[i].last_use = ++use_clock;
+            return &snaps[i];
+        }
+    }
+    return NULL;
+}
+
+static void retire_buf(dirsnap_buf_t *b) {
+    if (b != NULL) ebr_retire(b, sizeof(*b) + b->cap, free);
+}
+
+// 发布新的内容，旧的缓冲区可能正被其他读者遍历，交给 ebr 推迟释放
+static void publish(dirsnap_t *s, dirsnap_buf_t *b) {
+    dirsnap_buf_t *old = s->buf;
+    __atomic_store_n(&s->buf, b, __ATOMIC_RELEASE);
+    retire_buf(old);
+}
+
+static dirsnap_buf_t *alloc_buf(size_t cap) {
+    dirsnap_buf_t *b = malloc(sizeof(*b) + cap);
+    if (b != NULL) b->cap = cap;
+    return b;
+}
+
+dirsnap_t *dirsnap_new(uint32_t dir) {
+    dirsnap_drop(dir);
+    dirsnap_t *victim = &snaps[0];
+    for (int i = 0; i < DIRSNAP_SLOTS; ++i) {
+        if (!snaps[i].used) {
+            victim = &snaps[i];
+            break;
+        }
+        if (snaps[i].last_use < victim->last_use) victim = &snaps[i];
+    }
+    publish(victim, NULL);
+    victim->dir = dir;
+    victim->used = true;
+    victim->last_use = ++use_clock;
+    return victim;
+}
+
+int dirsnap_append(dirsnap_t *s, const char *name, uint32_t inode_num, uint32_t mode) {
+    size_t name_len = strlen(name);
+    dirsnap_buf_t *b = s->buf;
+    size_t len = b ? b->len : 0;
+    size_t need = len + RECORD_HEADER + name_len + 1;
+    if (name_len > UINT8_MAX || need > DIRSNAP_MAX_BYTES) return -1;
+    // 空间不够时复制到更大的缓冲区，写完记录后再发布
+    dirsnap_buf_t *target = b;
+    if (b == NULL || need > b->cap) {
+        size_t cap = b ? b->cap : 1024;
+        while (cap < need) cap *= 2;
+        target = alloc_buf(cap);
+        if (target == NULL) return -1;
+        if (len > 0) memcpy(target->data, b->data, len);
+    }
+    char *p = target->data + len;
+    memcpy(p, &inode_num, 4);
+    p[4] = (char)(mode >> 12);
+    p[5] = (char)name_len;
+    memcpy(p + RECORD_HEADER, name, name_len + 1);
+    __atomic_store_n(&target->len, need, __ATOMIC_RELEASE);
+    if (target != b) publish(s, target);
+    return 0;
+}
+
+const dirsnap_buf_t *dirsnap_view(const dirsnap_t *s) {
+    return __atomic_load_n(&s->buf, __ATOMIC_ACQUIRE);
+}
+
+const char *dirsnap_next(const dirsnap_buf_t *b, size_t *pos, uint32_t *inode_num, uint32_t *mode) {
+    if (b == NULL || *pos >= __atomic_load_n(&b->len, __ATOMIC_ACQUIRE)) return NULL;
+    const char *p = b->data + *pos;
+    memcpy(inode_num, p, 4);
+    *mode = (uint32_t)(unsigned char)p[4] << 12;
+    *pos += RECORD_HEADER + (unsigned char)p[5] + 1;
+    return p + RECORD_HEADER;
+}
+
+void dirsnap_add(uint32_t dir, const char *name, uint32_t inode_num, uint32_t mode) {
+    dirsnap_t *s = dirsnap_get(dir);
+    if (s && dirsnap_append(s, name, inode_num, mode) != 0) dirsnap_drop(dir);
+}
+
+// 删除会移动后面的记录，所以复制出一份不含该记录的新缓冲区
+void dirsnap_remove(uint32_t dir, const char *name) {
+    dirsnap_t *s = dirsnap_get(dir);
+    if (s == NULL || s->buf == NULL) return;
+    dirsnap_buf_t *b = s->buf;
+    size_t pos = 0;
+    while (pos < b->len) {
+        const char *p = b->data + pos;
+        size_t rec_len = RECORD_HEADER + (unsigned char)p[5] + 1;
+        if (strcmp(p + RECORD_HEADER, name) == 0) {
+            dirsnap_buf_t *nb = alloc_buf(b->cap);
+            if (nb == NULL) {
+                dirsnap_drop(dir);
+                return;
+            }
+            memcpy(nb->data, b->data, pos);
+            memcpy(nb->data + pos, p + rec_len, b->len - pos - rec_len);
+            nb->len = b->len - rec_len;
+            publish(s, nb);
+            return;
+        }
+        pos += rec_len;
+    }
+}
+
+void dirsnap_drop(uint32_t dir) {
+    for (int i = 0; i < DIRSNAP_SLOTS; ++i) {
+        if (snaps[i].used && snaps[i].dir == dir) {
+            snaps[i].used = false;
+            publish(&snaps[i], NULL);
+        }
+    }
+}
+
+void dirsnap_clear(void) {
+    for (int i = 0; i < DIRSNAP_SLOTS; ++i) {
+        snaps[i].used = false;
+        publish(&snaps[i], NULL);
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef DIRSNAP_H
+#define DIRSNAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// 同时缓存快照的目录数量
+#define DIRSNAP_SLOTS 64
+// 单个目录快照的最大字节数，超过则不缓存该目录
+#define DIRSNAP_MAX_BYTES (256 * 1024)
+
+// 快照的内容
+//
+// data 中顺序存放变长记录：inode 编号(4) | 类型(1) | 名字长度(1) | 名字 | '\0'
+// 类型为 mode >> 12，即 S_IFMT 部分。
+// 已发布的字节（len 之前）不再修改：追加只写 len 之后的空间，写完再发布新的 len；
+// 删除和扩容都复制出新的缓冲区替换 dirsnap_t.buf，旧的交给 ebr 推迟释放
+typedef struct dirsnap_buf {
+    size_t len;          // 已发布的字节数，原子读写
+    size_t cap;
+    char data[];
+} dirsnap_buf_t;
+
+// 一个目录的 readdir 快照
+typedef struct dirsnap {
+    uint32_t dir;        // 目录 inode 编号
+    bool used;
+    uint64_t last_use;   // 用于 LRU 替换
+    dirsnap_buf_t *buf;  // 原子读写，NULL 表示空快照
+} dirsnap_t;
+
+// 返回目录 dir 的快照，不存在时返回 NULL
+dirsnap_t *dirsnap_get(uint32_t dir);
+
+// 为目录 dir 建立一个空快照（必要时替换最久未用的快照），随后用 dirsnap_append 填充
+dirsnap_t *dirsnap_new(uint32_t dir);
+
+// 向快照追加一条记录，超过大小限制时返回 -1，此时调用者应 dirsnap_drop
+int dirsnap_append(dirsnap_t *s, const char *name, uint32_t inode_num, uint32_t mode);
+
+// 取得快照当前的内容，在 ebr 临界区中使用，遍历期间不受并发修改的影响
+const dirsnap_buf_t *dirsnap_view(const dirsnap_t *s);
+
+// 遍历快照内容，*pos 从 0 开始，返回名字，遍历结束返回 NULL
+const char *dirsnap_next(const dirsnap_buf_t *b, size_t *pos, uint32_t *inode_num, uint32_t *mode);
+
+// 以下三个函数用于在目录被修改时增量维护快照，目录没有快照时什么都不做
+void dirsnap_add(uint32_t dir, const char *name, uint32_t inode_num, uint32_t mode);
+void dirsnap_remove(uint32_t dir, const char *name);
+void dirsnap_drop(uint32_t dir);
+
+// 丢弃所有快照，挂载时调用，快照中的 inode 编号只在一次挂载内有效
+void dirsnap_clear(void);
+
+#endif
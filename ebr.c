@@ -0,0 +1,174 @@
+#include "ebr.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "logger.h"
+
+typedef struct retired {
+    void *p;
+    size_t bytes;
+    void (*release)(void *);
+    struct retired *next;
+} retired_t;
+
+// 每个读者线程一个槽：active 为 0 表示不在临界区，否则为进入时的 epoch + 1
+static struct {
+    uint64_t active;
+    int used;
+} slots[EBR_MAX_THREADS];
+
+static uint64_t global_epoch;
+// limbo[e % 3] 存放在 epoch e 退役的对象
+static retired_t *limbo[3];
+static size_t deferred;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static __thread int my_slot = -1;
+static __thread int depth;
+// 线程退出时通过 slot_key 的析构函数归还槽，值为槽号 + 1
+static pthread_key_t slot_key;
+static pthread_once_t slot_key_once = PTHREAD_ONCE_INIT;
+
+static struct {
+    uint64_t retired;
+    uint64_t reclaimed;
+    uint64_t stalls;            // 因超过推迟上限而等待的次数
+    size_t peak;
+} stats;
+
+static void release_slot(void *value) {
+    int i = (int)(intptr_t)value - 1;
+    __atomic_store_n(&slots[i].active, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&slots[i].used, 0, __ATOMIC_RELEASE);
+}
+
+static void create_slot_key(void) {
+    if (pthread_key_create(&slot_key, release_slot) != 0) {
+        fs_error("ebr: pthread_key_create failed, slots of exited threads will not be reused\n");
+    }
+}
+
+// 同时存在的读者线程超过 EBR_MAX_THREADS 时等待其他线程退出
+static int claim_slot(void) {
+    pthread_once(&slot_key_once, create_slot_key);
+    for (bool warned = false;; sched_yield()) {
+        for (int i = 0; i < EBR_MAX_THREADS; ++i) {
+            int expected = 0;
+            if (__atomic_compare_exchange_n(&slots[i].used, &expected, 1, false, __ATOMIC_ACQ_REL,
+                                            __ATOMIC_RELAXED)) {
+                pthread_setspecific(slot_key, (void *)(intptr_t)(i + 1));
+                return i;
+            }
+        }
+        if (!warned) {
+            fs_warning("ebr: more than %d live reader threads, waiting for a slot\n", EBR_MAX_THREADS);
+            warned = true;
+        }
+    }
+}
+
+int ebr_enter(void) {
+    if (depth++ > 0) return 0;
+    if (my_slot < 0) my_slot = claim_slot();
+    uint64_t e = __atomic_load_n(&global_epoch, __ATOMIC_ACQUIRE);
+    __atomic_store_n(&slots[my_slot].active, e + 1, __ATOMIC_RELAXED);
+    // 发布 active 之后才能读共享结构
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return 0;
+}
+
+static void free_list(retired_t *r) {
+    while (r != NULL) {
+        retired_t *next = r->next;
+        r->release(r->p);
+        deferred -= r->bytes;
+        stats.reclaimed++;
+        free(r);
+        r = next;
+    }
+}
+
+// 所有活跃读者都已经看到当前 epoch 时前进一次，并回收两个 epoch 之前退役的对象
+// 调用者持有 lock
+static bool try_advance(void) {
+    uint64_t e = __atomic_load_n(&global_epoch, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < EBR_MAX_THREADS; ++i) {
+        uint64_t a = __atomic_load_n(&slots[i].active, __ATOMIC_ACQUIRE);
+        if (a != 0 && a != e + 1) return false;
+    }
+    __atomic_store_n(&global_epoch, e + 1, __ATOMIC_RELEASE);
+    // epoch e - 1 退役的对象此时已经没有读者能看到
+    retired_t *old = limbo[(e + 2) % 3];
+    limbo[(e + 2) % 3] = NULL;
+    free_list(old);
+    return true;
+}
+
+void ebr_exit(void) {
+    if (--depth > 0) return;
+    __atomic_store_n(&slots[my_slot].active, 0, __ATOMIC_RELEASE);
+    if (__atomic_load_n(&deferred, __ATOMIC_RELAXED) > 0 && pthread_mutex_trylock(&lock) == 0) {
+        // 两次前进后，当前 epoch 之前退役的对象都可以回收
+        if (try_advance()) try_advance();
+        pthread_mutex_unlock(&lock);
+    }
+}
+
+void ebr_scope_end(int *unused) {
+    (void)unused;
+    ebr_exit();
+}
+
+void ebr_retire(void *p, size_t bytes, void (*release)(void *)) {
+    if (p == NULL) return;
+    retired_t *r = malloc(sizeof(*r));
+    if (r == NULL) {
+        fs_error("ebr: out of memory, leaking %zu bytes\n", bytes);
+        return;
+    }
+    r->p = p;
+    r->bytes = bytes;
+    r->release = release;
+
+    pthread_mutex_lock(&lock);
+    uint64_t e = __atomic_load_n(&global_epoch, __ATOMIC_ACQUIRE);
+    r->next = limbo[e % 3];
+    limbo[e % 3] = r;
+    deferred += bytes;
+    stats.retired++;
+    if (deferred > stats.peak) stats.peak = deferred;
+    if (deferred > EBR_DEFERRED_LIMIT) {
+        // 等其他线程的读者离开；当前线程自己若在临界区中，本 epoch 的对象只能等它离开后回收
+        stats.stalls++;
+        for (int spins = 0; deferred > EBR_DEFERRED_LIMIT && spins < 1000; ++spins) {
+            if (try_advance()) continue;
+            if (depth > 0) {
+                uint64_t mine = __atomic_load_n(&slots[my_slot].active, __ATOMIC_RELAXED);
+                if (mine != __atomic_load_n(&global_epoch, __ATOMIC_RELAXED) + 1) break;
+            }
+            pthread_mutex_unlock(&lock);
+            sched_yield();
+            pthread_mutex_lock(&lock);
+        }
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+size_t ebr_deferred_bytes(void) {
+    return __atomic_load_n(&deferred, __ATOMIC_RELAXED);
+}
+
+void ebr_shutdown(void) {
+    pthread_mutex_lock(&lock);
+    fs_important("ebr: %llu retired, %llu reclaimed before unmount, peak deferred %zu bytes, %llu stalls\n",
+                 (unsigned long long)stats.retired, (unsigned long long)stats.reclaimed, stats.peak,
+                 (unsigned long long)stats.stalls);
+    for (int i = 0; i < 3; ++i) {
+        free_list(limbo[i]);
+        limbo[i] = NULL;
+    }
+    pthread_mutex_unlock(&lock);
+}
@@ -0,0 +1,37 @@
+#ifndef EBR_H
+#define EBR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 基于 epoch 的内存回收
+//
+// 读者在每个 FUSE 回调中用 EBR_SCOPE 进入临界区，期间可以不加锁地读取共享结构
+// （目前是目录快照）；写者把被替换或换出的对象交给 ebr_retire，
+// 等所有在它退役时已经进入临界区的读者都离开后（全局 epoch 前进两次）才真正释放。
+//
+// 每个线程第一次进入时占用一个槽，线程退出时归还，同时存在的读者线程最多 EBR_MAX_THREADS 个。
+//
+// 推迟释放的总字节数受 EBR_DEFERRED_LIMIT 约束：超过时 ebr_retire 会等待其他线程的读者离开，
+// 当前线程自己的临界区中退役的对象在它离开时回收
+#define EBR_MAX_THREADS 64
+#define EBR_DEFERRED_LIMIT (4 << 20)
+
+// 进入 / 离开临界区，可以嵌套，开销是一次原子写和一次内存屏障
+int ebr_enter(void);
+void ebr_exit(void);
+
+// 在回调开头使用，回调返回时自动离开临界区
+void ebr_scope_end(int *unused);
+#define EBR_SCOPE() int ebr_scope_ __attribute__((cleanup(ebr_scope_end))) = ebr_enter()
+
+// 推迟释放 p，bytes 用于统计推迟的内存总量，回收时调用 release(p)
+void ebr_retire(void *p, size_t bytes, void (*release)(void *));
+
+// 当前推迟释放的字节数
+size_t ebr_deferred_bytes(void);
+
+// 输出统计，并释放全部推迟的对象（卸载时调用，此时不应再有读者）
+void ebr_shutdown(void);
+
+#endif
@@ -19,9 +19,18 @@
 #include <unistd.h>
 #include <utime.h>
 
+#include "arena.h"
+#include "cache.h"
+#include "changelog.h"
+#include "dirsnap.h"
 #include "disk.h"
+#include "ebr.h"
 #include "fs_opt.h"
+#include "fslab_ioctl.h"
+#include "heat.h"
 #include "logger.h"
+#include "perf.h"
+#include "stream.h"
 
 // 默认的文件和目录的标志
 #define DIRMODE (S_IFDIR | 0755)
@@ -30,12 +39,15 @@
 // 一些辅助宏定义
 #define ceil_div(a, b) (((a) + (b) - 1) / (b))
 #define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
 #define MAX_FILENAME_LEN 24
 #define INODE_COUNT 32768
 
 #define INODE_SIZE sizeof(inode_t)
-#define INODES_PER_BLOCK (BLOCK_SIZE / INODE_SIZE)
-#define ENTRIES_PER_BLOCK (BLOCK_SIZE / sizeof(dir_entry_t))
+// inode 表块和目录块的最后 CHECKSUM_SIZE 字节留给校验和
+#define INODES_PER_BLOCK ((BLOCK_SIZE - CHECKSUM_SIZE) / INODE_SIZE)
+#define ENTRIES_PER_BLOCK ((BLOCK_SIZE - CHECKSUM_SIZE) / sizeof(dir_entry_t))
+#define BITMAP_BITS_PER_BLOCK ((BLOCK_SIZE - CHECKSUM_SIZE) * 8)
 #define POINTERS_PER_BLOCK (BLOCK_SIZE / sizeof(int))
 
 #define DIRECT_POINTERS 12
@@ -47,43 +59,182 @@ typedef struct inode{
     uint32_t mtime;
     uint32_t ctime;
     uint32_t mode;
+    uint32_t parent;    // 父目录 inode 编号，根目录指向自己
+    uint32_t blocks;    // 已分配的数据块数（包括间接块）
+    uint32_t tree_bytes;    // 仅目录使用：以该目录为根的子树（含自身）的总字节数
+    uint32_t tree_blocks;   // 仅目录使用：子树已分配的数据块数
+    uint32_t tree_files;    // 仅目录使用：子树中的条目数（含自身）
+    uint32_t policy;        // FSLAB_POLICY_* 的组合，见 fslab_ioctl.h
+    uint32_t cbt_block;     // 变更块跟踪位图所在的块，0 表示没有设置检查点，见 FSLAB_IOC_CHECKPOINT
     uint32_t direct_block_pointer[DIRECT_POINTERS];
     uint32_t indirect_block_pointer[INDIRECT_POINTERS];
 } inode_t;
 struct superblock{
     int num_inodes;
     int num_data_blocks;
-    int inode_table_blocks;
+    int inode_table_blocks;     // 动态格式下为 inode 块映射的槽数
     int data_bitmap_blocks;
     int data_blocks_start;
+    int flags;
+    int change_log_start;       // 变更日志的位置，change_log_blocks 为 0 表示没有，见 changelog.h
+    int change_log_blocks;
 } sb;
+#define SB_DYNAMIC_INODES 0x1   // inode 表按块从数据区按需分配，见 inode_table_block
 typedef struct dir_entry {
     char name[26]; // 示例
     uint32_t inode_num;
 } dir_entry_t;
 
+// 最近被追加写的文件的尾块：块号已经解析好，对应的缓存块一直钉住，
+// 连续的追加写只需要 memcpy，直到尾块写满或文件被截断、删除
+#define TAIL_SLOTS 16
+typedef struct tail_block {
+    uint32_t inode_num;     // 0 表示空槽（根目录不会被写）
+    int file_block_idx;
+    buf_t *bh;
+    uint64_t last_use;
+} tail_block_t;
+
+// 文件块映射上的一段连续区间：物理块连续，或者全部是空洞
+#define EXTENT_HOLE FSLAB_EXTENT_HOLE
+#define EXTENT_LAST FSLAB_EXTENT_LAST
+typedef struct extent {
+    uint32_t logical;       // 起始逻辑块号
+    uint32_t physical;      // 起始物理块号，空洞为 0
+    uint32_t length;        // 块数
+    uint32_t flags;
+} extent_t;
+
+// 按逻辑块顺序遍历文件块映射，当前所在的间接块保持钉住，每个间接块只读一次
+typedef struct extent_iter {
+    const inode_t *inode;
+    uint32_t next;          // 下一个要处理的逻辑块
+    uint32_t end;           // 结束逻辑块（不含）
+    int group;              // indirect 对应的间接指针下标，-1 表示没有
+    buf_t *indirect;
+} extent_iter_t;
+
+// fs_write 按块分类的计数，卸载时输出
+struct write_stats {
+    uint64_t full_overwrites;   // 整块覆盖
+    uint64_t partial_heads;     // 请求开头不从块首开始的部分块
+    uint64_t partial_tails;     // 请求末尾没有写满的部分块
+    uint64_t hole_fills;        // 新分配的块（空洞或文件末尾之后）
+    uint64_t reads;             // 写入前需要读出旧内容的块
+    uint64_t reads_avoided;     // 省掉的读
+    uint64_t streamed;          // 经流水线绕过缓存直接写盘的块
+} write_stats;
+
+// 直接 I/O：挂载时带 --direct-io 时对大文件和只写打开的文件启用，打开时带 O_DIRECT 时总是启用。
+// 启用后内核不经过页缓存（fi->direct_io），不在块缓存中的整块数据也直接读写磁盘，
+// 一次性的大流不会把缓存里有用的块挤出去；元数据和部分块仍然走缓存
+#define DIRECT_IO_MIN_SIZE (1 << 20)
+#define FH_DIRECT_IO 0x1            // 记在 fi->fh 中，read/write 据此判断
+static bool mount_direct_io;
+// 顺序访问提示的文件每次读之后预读的块数
+#define READAHEAD_BLOCKS 32
+
+struct direct_stats {
+    uint64_t opens;
+    uint64_t reads;             // 绕过缓存读的块
+    uint64_t writes;            // 绕过缓存写的块
+} direct_stats;
+
+// 每个 FUSE 回调开头的公共工作：性能计数、进入 ebr 临界区、回收 arena、
+// 受限延迟模式下重置预算并偿还一部分推迟的工作
+#define REQUEST_BEGIN(op) \
+    PERF_SCOPE(op);       \
+    EBR_SCOPE();          \
+    arena_reset();        \
+    request_begin()
+
+// 受限延迟模式（--latency-budget=N）：每个请求最多做 N 个单位的可推迟工作。
+// 截断和删除时整个间接块组的释放交给 pending_frees，由之后的请求分批完成；
+// 积压超过 PENDING_HIGH_WATER 个块时每个请求多做几倍，数据块不够分配时立即全部完成
+#define PENDING_GROUPS 4096
+#define PENDING_HIGH_WATER (16 * 1024)
+typedef struct pending_free {
+    uint32_t indirect;      // 已经从 inode 上摘下的间接块
+    uint32_t next;          // 下一个要释放的指针下标
+} pending_free_t;
+static int latency_budget;
+static pending_free_t pending_frees[PENDING_GROUPS];
+static int pending_n;
+static int64_t pending_blocks;
+static uint64_t background_freed;
+
 // 磁盘布局: 块号
 #define SUPERBLOCK_BLOCK 0
-#define INODE_BITMAP_BLOCK 1
-#define DATA_BITMAP_START_BLOCK 2 // 数据位图占用2块
-#define INODE_TABLE_START_BLOCK 4
+#define INODE_BITMAP_BLOCK 1 // inode 位图占用2块（每块末尾有校验和，一块放不下 32768 位）
+#define INODE_BITMAP_BLOCKS 2
+#define DATA_BITMAP_START_BLOCK 3 // 数据位图占用2块
+#define INODE_TABLE_START_BLOCK 5
+// 动态格式（--dynamic-inodes）：第 5 块是 inode 块映射，第 t 项为存放 inode [t*INODES_PER_BLOCK, ...) 的块号，
+// 0 表示还没有分配；映射常驻内存，查找是 O(1) 的
+#define INODE_CHUNK_MAP_BLOCK 5
+#define INODE_CHUNKS_MAX ((BLOCK_SIZE - CHECKSUM_SIZE) / sizeof(uint32_t))
+static uint32_t inode_chunk_map[INODE_CHUNKS_MAX];
+static bool format_dynamic_inodes;
+static bool format_change_log;
 
 
 int get_inode_by_path(const char *path, int *parent_inode_num, char *filename);
+inode_t *get_inode(int inode_num, buf_t **handle);
 int read_inode(int inode_num, inode_t *inode);
 int write_inode(int inode_num, const inode_t *inode);
-int alloc_inode();
+int alloc_inode(int parent_inode_num);
+int inode_table_block(int t);
+int alloc_inode_chunk(int t);
 uint32_t get_directory_block_addr(struct inode *dir_inode, uint32_t block_index);
 int find_entry_in_directory(struct inode *dir_inode, const char *name, uint32_t *inode_index);
 int find_inode_by_path(const char *path, uint32_t *inode_index);
 
 void free_inode(int inode_num);
+void prefetch_inode_blocks(int *blocks, int n);
+void note_inode_block(char *seen, int *blocks, int *n, uint32_t inode_num);
+dirsnap_t *build_dirsnap(uint32_t inode_num, inode_t *dir_inode);
 int alloc_data_block();
+int bitmap_alloc(int start_block, int lo, int hi);
+int bitmap_find_zero(buf_t *const *maps, int lo, int hi);
+void bitmap_clear(int start_block, int i);
 void free_data_block(int block_num);
 void update_timestamp(inode_t *inode, bool access, bool modify, bool change);
 int add_dir_entry(inode_t *parent_inode, int parent_inode_num, const char *filename, int new_inode_num);
 int get_block_num(inode_t *inode, int file_block_idx, bool allocate);
 void free_all_data_blocks(inode_t *inode);
+void free_blocks_from(inode_t *inode, int first);
+int make_node(const char *path, uint32_t mode);
+int remove_dir_entry(inode_t *dir_inode, const char *name, uint32_t *inode_index);
+bool dir_is_empty(inode_t *dir_inode);
+int remove_node(const char *path, bool is_dir);
+bool is_ancestor(uint32_t ancestor, uint32_t inode_num);
+int inode_to_path(uint32_t inode_num, char *buf, size_t size);
+void usage_of(const inode_t *node, int64_t *bytes, int64_t *blocks, int64_t *files);
+void update_usage(uint32_t dir, int64_t dbytes, int64_t dblocks, int64_t dfiles);
+buf_t *tail_lookup(uint32_t inode_num, int file_block_idx);
+void tail_remember(uint32_t inode_num, int file_block_idx, buf_t *bh);
+void tail_forget(uint32_t inode_num);
+void tail_forget_all(void);
+int take_flag(int *argc_ptr, char *argv[], const char *prefix, const char **value);
+void request_begin(void);
+bool pending_free_push(uint32_t indirect, int64_t count);
+void pending_free_run(int units);
+int read_uncached(int block, char *buf);
+int write_uncached(int block, const char *buf);
+int sync_file(uint32_t inode_num, const inode_t *inode, uint32_t first, uint32_t end);
+void readahead_file(const inode_t *inode, uint32_t first);
+int policy_parse(const char *text, size_t len, uint32_t *policy);
+int policy_format(uint32_t policy, char *buf, size_t size);
+int set_policy(uint32_t inode_num, inode_t *inode, uint32_t policy);
+uint64_t query_end(uint64_t start, uint64_t length, uint64_t size);
+int scan_inodes(struct fslab_inode_scan *q);
+void cbt_mark(const inode_t *inode, uint32_t first, uint32_t end);
+int cbt_checkpoint(uint32_t inode_num, inode_t *inode);
+int cbt_ranges(const inode_t *inode, struct fslab_range_query *q);
+void extent_iter_init(extent_iter_t *it, const inode_t *inode, uint32_t first, uint32_t end);
+uint32_t extent_iter_lookup(extent_iter_t *it, uint32_t file_block_idx);
+bool extent_iter_next(extent_iter_t *it, extent_t *ext);
+void extent_iter_done(extent_iter_t *it);
 // 初始化文件系统
 //
 // 参考实现：
@@ -102,26 +253,53 @@ void free_all_data_blocks(inode_t *inode);
 int fs_mount(int init_flag) {
     fs_info("fs_mount is called\tinit_flag:%d)\n", init_flag);
 
+    cache_init();
+    arena_reset();
+    dirsnap_clear();
+    memset(inode_chunk_map, 0, sizeof(inode_chunk_map));
+    // 固定位置的分区先登记，读超级块本身也能统计到
+    heat_clear_parts();
+    heat_add_part("superblock", SUPERBLOCK_BLOCK, INODE_BITMAP_BLOCK);
+    heat_add_part("inode bitmap", INODE_BITMAP_BLOCK, DATA_BITMAP_START_BLOCK);
+    heat_add_part("data bitmap", DATA_BITMAP_START_BLOCK, INODE_TABLE_START_BLOCK);
     if(init_flag){
-        sb.num_inodes = INODE_COUNT;
-        sb.inode_table_blocks = ceil_div(sb.num_inodes * sizeof(inode_t), BLOCK_SIZE);
+        if (format_dynamic_inodes) {
+            // 格式化时只需要写位图和映射块，inode 数量受映射槽数和 inode 位图大小限制
+            sb.flags = SB_DYNAMIC_INODES;
+            sb.num_inodes = min((int)(INODE_CHUNKS_MAX * INODES_PER_BLOCK), 2 * (int)BITMAP_BITS_PER_BLOCK);
+            sb.inode_table_blocks = ceil_div(sb.num_inodes, INODES_PER_BLOCK);
+            sb.data_blocks_start = INODE_CHUNK_MAP_BLOCK + 1;
+        } else {
+            sb.flags = 0;
+            sb.num_inodes = INODE_COUNT;
+            sb.inode_table_blocks = ceil_div(sb.num_inodes, INODES_PER_BLOCK);
+            sb.data_blocks_start = INODE_TABLE_START_BLOCK + sb.inode_table_blocks;
+        }
+        // 变更日志紧接在元数据区之后，和位图、inode 表一起在下面清零
+        sb.change_log_start = format_change_log ? sb.data_blocks_start : 0;
+        sb.change_log_blocks = format_change_log ? CHANGE_LOG_BLOCKS : 0;
+        sb.data_blocks_start += sb.change_log_blocks;
         sb.data_bitmap_blocks = 2; // 根据设计计算得出
-        sb.data_blocks_start = INODE_TABLE_START_BLOCK + sb.inode_table_blocks;
-        sb.num_data_blocks = BLOCK_NUM - sb.data_blocks_start;
+        sb.num_data_blocks = min(BLOCK_NUM - sb.data_blocks_start, 2 * (int)BITMAP_BITS_PER_BLOCK);
 
-        char block[BLOCK_SIZE];
+        char *block = arena_alloc(BLOCK_SIZE);
+        if (block == NULL) {
+            return -1;
+        }
         memset(block, 0, BLOCK_SIZE);
         memcpy(block, &sb, sizeof(sb));
+        block_seal(block);
         disk_write(SUPERBLOCK_BLOCK, block);
 
-        // 初始化所有位图和Inode表
+        // 初始化所有位图和Inode表，这些块绕过缓存直接写盘，需要自己加上校验和
         memset(block, 0, BLOCK_SIZE);
+        block_seal(block);
         for (int i = INODE_BITMAP_BLOCK; i < sb.data_blocks_start; ++i) {
             disk_write(i, block);
         }
 
         // 初始化根目录
-        int root_inode_num = alloc_inode();
+        int root_inode_num = alloc_inode(0);
         if (root_inode_num != 0) {
             fs_error("Root inode is not 0\n");
             return -1;
@@ -130,14 +308,37 @@ int fs_mount(int init_flag) {
         inode_t root_inode;
         memset(&root_inode, 0, sizeof(inode_t));
         root_inode.mode = DIRMODE;
+        root_inode.parent = root_inode_num;
         root_inode.size = 0; // Empty dir initially
+        root_inode.tree_files = 1;
         update_timestamp(&root_inode, true, true, true);
         write_inode(root_inode_num, &root_inode);
     }
     else{
         // 加载超级块
-        disk_read(SUPERBLOCK_BLOCK, &sb);  
+        buf_t *bh = cache_get_meta(SUPERBLOCK_BLOCK);
+        if (bh == NULL) {
+            return -1;
+        }
+        memcpy(&sb, bh->data, sizeof(sb));
+        cache_put(bh);
+        if (sb.flags & SB_DYNAMIC_INODES) {
+            if ((bh = cache_get_meta(INODE_CHUNK_MAP_BLOCK)) == NULL) {
+                return -1;
+            }
+            memcpy(inode_chunk_map, bh->data, sizeof(inode_chunk_map));
+            cache_put(bh);
+        }
+    }
+    changelog_open(sb.change_log_start, sb.change_log_blocks);
+    // 动态格式下 inode 表块分散在数据区中，计入 data
+    if (sb.flags & SB_DYNAMIC_INODES) {
+        heat_add_part("inode map", INODE_CHUNK_MAP_BLOCK, INODE_CHUNK_MAP_BLOCK + 1);
+    } else {
+        heat_add_part("inode table", INODE_TABLE_START_BLOCK, INODE_TABLE_START_BLOCK + sb.inode_table_blocks);
     }
+    heat_add_part("change log", sb.change_log_start, sb.change_log_start + sb.change_log_blocks);
+    heat_add_part("data", sb.data_blocks_start, BLOCK_NUM);
     return 0;
 }
 
@@ -147,6 +348,41 @@ int fs_mount(int init_flag) {
 // fs_finalize 函数中完成，你可以假设 fuse_status 永远为 0，即 fuse
 // 永远会正常退出，该函数当且仅当清理工作失败时返回非零值
 int fs_finalize(int fuse_status) {
+    fs_important("cache: %llu checksum errors\n", (unsigned long long)cache_checksum_errors());
+    cache_report();
+    fs_important("arena: high water %zu bytes, %zu overflows\n", arena_high_water(), arena_overflows());
+    fs_important("write: %llu full, %llu head, %llu tail, %llu hole, %llu reads, %llu reads avoided, %llu streamed\n",
+                 (unsigned long long)write_stats.full_overwrites, (unsigned long long)write_stats.partial_heads,
+                 (unsigned long long)write_stats.partial_tails, (unsigned long long)write_stats.hole_fills,
+                 (unsigned long long)write_stats.reads, (unsigned long long)write_stats.reads_avoided,
+                 (unsigned long long)write_stats.streamed);
+    fs_important("direct: %llu opens, %llu reads, %llu writes bypassed the cache\n",
+                 (unsigned long long)direct_stats.opens, (unsigned long long)direct_stats.reads,
+                 (unsigned long long)direct_stats.writes);
+    perf_report();
+    ebr_shutdown();
+    if (latency_budget > 0) {
+        fs_important("latency: budget %d, %llu blocks freed in the background, %lld still pending\n", latency_budget,
+                     (unsigned long long)background_freed, (long long)pending_blocks);
+    }
+    // 每次失败会把一组换到队首，最多再给每组一次机会
+    for (int tries = pending_n; tries >= 0 && pending_n > 0; --tries) {
+        pending_free_run(-1);
+    }
+    if (pending_n > 0) {
+        fs_error("fs_finalize: %d indirect groups (%lld blocks) could not be freed and are leaked\n", pending_n,
+                 (long long)pending_blocks);
+    }
+    stream_shutdown();
+    tail_forget_all();
+    if (cache_flush() != 0) {
+        fs_error("fs_finalize: cache flush failed\n");
+        return -1;
+    }
+    const char *heatmap = getenv("FSLAB_HEATMAP");
+    if (heatmap != NULL && heat_dump(heatmap) != 0) {
+        fs_error("fs_finalize: write heat map to %s failed\n", heatmap);
+    }
     return fuse_status;
 }
 
@@ -166,6 +402,7 @@ int fs_finalize(int fuse_status) {
 // `stat` 会触发该函数，实际上 `cd` 的时候也会触发，这个函数被触发的情景特别多
 int fs_getattr(const char* path, struct stat* attr) {
     fs_info("fs_getattr is called:%s\n", path);
+    REQUEST_BEGIN(PERF_GETATTR);
     uint32_t inode_index;
     inode_t target;
       // 根据路径查找inode
@@ -190,7 +427,7 @@ int fs_getattr(const char* path, struct stat* attr) {
         .st_mtim = target.mtime,       // 最后修改时间（内容）
         .st_ctim = target.ctime,       // 最后修改时间（元数据）
         .st_blksize = BLOCK_SIZE,  // 文件的最小分配单位大小（字节记）
-        .st_blocks = (target.size + 511) / 512,      // 实际占据的数据块数（以 512
+        .st_blocks = target.blocks * (BLOCK_SIZE / 512),      // 实际占据的数据块数（以 512
                              // 字节为一块，这是历史原因的规定，和 st_blksize
                              // 中的不一样），这个块数需要考虑文件系统实现的实际情况，
                              // 比如间接指针分配的那个数据块也应该算在这里。
@@ -214,6 +451,7 @@ int fs_getattr(const char* path, struct stat* attr) {
 // `ls` 命令会触发这个函数
 int fs_readdir(const char* path, void* buffer, fuse_fill_dir_t filler, off_t offset, struct fuse_file_info* fi) {
     fs_info("fs_readdir is called: %s\n", path);
+    REQUEST_BEGIN(PERF_READDIR);
 
     uint32_t inode_num;
     if (find_inode_by_path(path, &inode_num) != 0) {
@@ -232,29 +470,64 @@ int fs_readdir(const char* path, void* buffer, fuse_fill_dir_t filler, off_t off
     filler(buffer, ".", NULL, 0);
     filler(buffer, "..", NULL, 0);
 
-    dir_entry_t entries[ENTRIES_PER_BLOCK];
+    // 记录子条目所在的 inode 表块，列目录之后通常紧跟着对每个子条目的 getattr
+    char *seen = arena_alloc(sb.inode_table_blocks);
+    int *table_blocks = arena_alloc(sb.inode_table_blocks * sizeof(int));
+    int num_table_blocks = 0;
+    if (seen) memset(seen, 0, sb.inode_table_blocks);
 
-    uint32_t num_blocks_to_check = ceil_div(dir_inode.size, BLOCK_SIZE);
+    // 优先使用缓存的快照，未变化的目录重复列出时不需要扫描目录块
+    dirsnap_t *snap = dirsnap_get(inode_num);
+    if (snap == NULL) {
+        snap = build_dirsnap(inode_num, &dir_inode);
+    }
+    if (snap != NULL) {
+        const dirsnap_buf_t *view = dirsnap_view(snap);
+        size_t pos = 0;
+        uint32_t child, mode;
+        const char *name;
+        while ((name = dirsnap_next(view, &pos, &child, &mode)) != NULL) {
+            note_inode_block(seen, table_blocks, &num_table_blocks, child);
+            struct stat st = {.st_ino = child, .st_mode = mode};
+            if (filler(buffer, name, &st, 0) != 0) {
+                fs_warning("filler buffer is full, returning early.\n");
+                prefetch_inode_blocks(table_blocks, num_table_blocks);
+                return 0;
+            }
+        }
+        prefetch_inode_blocks(table_blocks, num_table_blocks);
+        update_timestamp(&dir_inode, true, false, false);
+        write_inode(inode_num, &dir_inode);
+        return 0;
+    }
 
+    // 目录太大无法建立快照时，直接扫描目录块
+    uint32_t num_blocks_to_check = ceil_div(dir_inode.size, BLOCK_SIZE);
     for (uint32_t i = 0; i < num_blocks_to_check; i++) {
         uint32_t block_addr = get_directory_block_addr(&dir_inode, i);
-
-        if (block_addr == 0 || disk_read(block_addr, entries) != 0) {
+        buf_t *bh;
+        if (block_addr == 0 || (bh = cache_get_meta(block_addr)) == NULL) {
          continue;
         }
 
         // 遍历块内的所有目录项
+        dir_entry_t *entries = (dir_entry_t *)bh->data;
         for (int j = 0; j < ENTRIES_PER_BLOCK; j++) {
             if (entries[j].inode_num != 0) {
+                note_inode_block(seen, table_blocks, &num_table_blocks, entries[j].inode_num);
                 if (filler(buffer, entries[j].name, NULL, 0) != 0) {
                     // 如果 FUSE 的缓冲区满了, 提前结束并返回成功
                     fs_warning("filler buffer is full, returning early.\n");
+                    cache_put(bh);
+                    prefetch_inode_blocks(table_blocks, num_table_blocks);
                     return 0;
                 }
             }
         }
+        cache_put(bh);
     }
 
+    prefetch_inode_blocks(table_blocks, num_table_blocks);
 
     update_timestamp(&dir_inode, true, false, false);
     write_inode(inode_num, &dir_inode);
@@ -276,8 +549,59 @@ int fs_readdir(const char* path, void* buffer, fuse_fill_dir_t filler, off_t off
 // `cat` 命令会触发这个函数
 int fs_read(const char* path, char* buffer, size_t size, off_t offset, struct fuse_file_info* fi) {
     fs_info("fs_read is called:%s\tsize:%d\toffset:%d\n", path, size, offset);
+    REQUEST_BEGIN(PERF_READ);
 
-    return 0;
+    uint32_t inode_num;
+    inode_t node;
+    if (find_inode_by_path(path, &inode_num) != 0 || read_inode(inode_num, &node) != 0) {
+        return -ENOENT;
+    }
+    if (S_ISDIR(node.mode)) {
+        return -EISDIR;
+    }
+    if (offset >= node.size) {
+        return 0;
+    }
+    size = min(size, node.size - offset);
+
+    bool direct = fi != NULL && (fi->fh & FH_DIRECT_IO);
+    bool nocache = node.policy & FSLAB_POLICY_NOCACHE;
+    char *scratch = nocache ? arena_alloc(BLOCK_SIZE) : NULL;
+    size_t done = 0;
+    extent_iter_t it;
+    extent_t ext;
+    extent_iter_init(&it, &node, offset / BLOCK_SIZE, ceil_div(offset + size, BLOCK_SIZE));
+    while (extent_iter_next(&it, &ext)) {
+        for (uint32_t k = 0; k < ext.length; ++k) {
+            int off = (offset + done) % BLOCK_SIZE;
+            size_t n = min(BLOCK_SIZE - off, size - done);
+            int block = ext.physical + k;
+            buf_t *bh;
+            bool uncached = !(ext.flags & EXTENT_HOLE) && !cache_contains(block);
+            // 直接 I/O 的整块读：缓存里没有就直接读到调用者的缓冲区
+            if (uncached && (direct || nocache) && n == BLOCK_SIZE && read_uncached(block, buffer + done) == 0) {
+                direct_stats.reads++;
+            } else if (uncached && scratch != NULL && read_uncached(block, scratch) == 0) {
+                // nocache 文件的部分块经临时缓冲区读出，同样不进入缓存
+                memcpy(buffer + done, scratch + off, n);
+                direct_stats.reads++;
+            } else if ((ext.flags & EXTENT_HOLE) || (bh = cache_get(block)) == NULL) {
+                memset(buffer + done, 0, n); // 空洞读出 0
+            } else {
+                memcpy(buffer + done, bh->data + off, n);
+                cache_put(bh);
+            }
+            done += n;
+        }
+    }
+    extent_iter_done(&it);
+    if ((node.policy & FSLAB_POLICY_SEQUENTIAL) && !nocache) {
+        readahead_file(&node, ceil_div(offset + size, BLOCK_SIZE));
+    }
+
+    update_timestamp(&node, true, false, false);
+    write_inode(inode_num, &node);
+    return size;
 }
 
 // 创建一个文件（忽略 mode 和 dev 参数）
@@ -295,8 +619,9 @@ int fs_read(const char* path, char* buffer, size_t size, off_t offset, struct fu
 // `touch` 命令会触发这个函数
 int fs_mknod(const char* path, mode_t mode, dev_t dev) {
     fs_info("fs_mknod is called:%s\n", path);
+    REQUEST_BEGIN(PERF_MKNOD);
 
-    return 0;
+    return make_node(path, REGMODE);
 }
 
 // 创建一个目录（忽略 mode 参数）
@@ -305,8 +630,9 @@ int fs_mknod(const char* path, mode_t mode, dev_t dev) {
 // 唯一的区别是其对应的 stat 记录的 `st_mode` 为 `DIRMODE`
 int fs_mkdir(const char* path, mode_t mode) {
     fs_info("fs_mkdir is called:%s\n", path);
+    REQUEST_BEGIN(PERF_MKDIR);
 
-    return 0;
+    return make_node(path, DIRMODE);
 }
 
 // 删除一个文件
@@ -323,8 +649,9 @@ int fs_mkdir(const char* path, mode_t mode) {
 // `rm` 命令会触发该函数
 int fs_unlink(const char* path) {
     fs_info("fs_unlink is callded:%s\n", path);
+    REQUEST_BEGIN(PERF_UNLINK);
 
-    return 0;
+    return remove_node(path, false);
 }
 
 // 删除一个目录
@@ -340,8 +667,9 @@ int fs_unlink(const char* path) {
 // 来处理递归删除，而不是交给文件系统来处理递归
 int fs_rmdir(const char* path) {
     fs_info("fs_rmdir is called:%s\n", path);
+    REQUEST_BEGIN(PERF_RMDIR);
 
-    return 0;
+    return remove_node(path, true);
 }
 
 // 移动一个条目（文件或目录）
@@ -362,7 +690,82 @@ int fs_rmdir(const char* path) {
 // `mv` 命令会触发该函数
 int fs_rename(const char* oldpath, const char* newpath) {
     fs_info("fs_rename is called:%s\tnewpath:%s\n", oldpath, newpath);
+    REQUEST_BEGIN(PERF_RENAME);
+
+    int old_parent_num, new_parent_num;
+    char old_name[MAX_FILENAME_LEN + 1], new_name[MAX_FILENAME_LEN + 1];
+    int ret = get_inode_by_path(oldpath, &old_parent_num, old_name);
+    if (ret != 0) return ret;
+    ret = get_inode_by_path(newpath, &new_parent_num, new_name);
+    if (ret != 0) return ret;
+
+    inode_t old_parent, new_parent, node;
+    uint32_t inode_num, target_num;
+    if (read_inode(old_parent_num, &old_parent) != 0 ||
+        find_entry_in_directory(&old_parent, old_name, &inode_num) != 0 ||
+        read_inode(inode_num, &node) != 0) {
+        return -ENOENT;
+    }
+    if (read_inode(new_parent_num, &new_parent) != 0) return -ENOENT;
+    if (!S_ISDIR(new_parent.mode)) return -ENOTDIR;
+
+    if (old_parent_num == new_parent_num && strcmp(old_name, new_name) == 0) {
+        return 0;
+    }
+    // 不能把目录移动到它自己的子树中，沿父指针向上检查即可
+    if (S_ISDIR(node.mode) && is_ancestor(inode_num, new_parent_num)) {
+        return -EINVAL;
+    }
+
+    // 子树统计的增量，所有 inode 写回之后再沿祖先链更新
+    int64_t bytes, blocks, files;
+    int64_t target_bytes = 0, target_blocks = 0, target_files = 0;
+    usage_of(&node, &bytes, &blocks, &files);
+
+    if (find_entry_in_directory(&new_parent, new_name, &target_num) == 0) {
+        inode_t target;
+        if (read_inode(target_num, &target) != 0) return -EIO;
+        if (S_ISDIR(node.mode) && !S_ISDIR(target.mode)) return -ENOTDIR;
+        if (!S_ISDIR(node.mode) && S_ISDIR(target.mode)) return -EISDIR;
+        if (S_ISDIR(target.mode) && !dir_is_empty(&target)) return -ENOTEMPTY;
+        usage_of(&target, &target_bytes, &target_blocks, &target_files);
+        remove_dir_entry(&new_parent, new_name, &target_num);
+        dirsnap_remove(new_parent_num, new_name);
+        if (S_ISDIR(target.mode)) {
+            dirsnap_drop(target_num);
+        } else {
+            tail_forget(target_num);
+        }
+        free_all_data_blocks(&target);
+        free_inode(target_num);
+        changelog_append(target_num, new_parent_num, FSLAB_CHANGE_REMOVE);
+    }
 
+    remove_dir_entry(&old_parent, old_name, &inode_num);
+    dirsnap_remove(old_parent_num, old_name);
+    update_timestamp(&old_parent, false, true, true);
+    write_inode(old_parent_num, &old_parent);
+
+    // 新旧父目录可能是同一个，重新读取以免覆盖上面的修改
+    if (read_inode(new_parent_num, &new_parent) != 0) return -EIO;
+    uint32_t old_size = new_parent.size, old_blocks = new_parent.blocks;
+    ret = add_dir_entry(&new_parent, new_parent_num, new_name, inode_num);
+    if (ret != 0) return ret;
+    dirsnap_add(new_parent_num, new_name, inode_num, node.mode);
+    update_timestamp(&new_parent, false, true, true);
+    write_inode(new_parent_num, &new_parent);
+
+    node.parent = new_parent_num;
+    update_timestamp(&node, false, false, true);
+    write_inode(inode_num, &node);
+    changelog_append(inode_num, old_parent_num, FSLAB_CHANGE_RENAME_FROM);
+    changelog_append(inode_num, new_parent_num, FSLAB_CHANGE_RENAME_TO);
+
+    update_usage(old_parent_num, -bytes, -blocks, -files);
+    update_usage(new_parent_num,
+                 bytes - target_bytes + ((int64_t)new_parent.size - old_size),
+                 blocks - target_blocks + ((int64_t)new_parent.blocks - old_blocks),
+                 files - target_files);
     return 0;
 }
 
@@ -384,8 +787,177 @@ int fs_rename(const char* oldpath, const char* newpath) {
 // `echo "hello world" > test.txt` 命令会触发这个函数
 int fs_write(const char* path, const char* buffer, size_t size, off_t offset, struct fuse_file_info* fi) {
     fs_info("fs_write is called:%s\tsize:%d\toffset:%d\n", path, size, offset);
+    REQUEST_BEGIN(PERF_WRITE);
 
-    return 0;
+    uint32_t inode_num;
+    inode_t node;
+    if (find_inode_by_path(path, &inode_num) != 0 || read_inode(inode_num, &node) != 0) {
+        return -ENOENT;
+    }
+    if (S_ISDIR(node.mode)) {
+        return -EISDIR;
+    }
+    // 长度为 0 的写什么也不改变，即使 offset 在文件末尾之后也不扩展文件
+    if (size == 0) {
+        return 0;
+    }
+    if (fi != NULL && (fi->flags & O_APPEND)) {
+        offset = node.size;
+    }
+    if (offset + size > MAX_FILE_SIZE) {
+        return -EFBIG;
+    }
+    // 写之前就记下，写到一半失败时多记的块只会让备份多读一些
+    cbt_mark(&node, offset / BLOCK_SIZE, ceil_div(offset + size, BLOCK_SIZE));
+
+    uint32_t old_size = node.size, old_blocks = node.blocks;
+    size_t done = 0;
+    buf_t *last = NULL;
+    // 跨越多批的大请求走流水线：不在缓存中的整块直接交给写线程，
+    // 写线程写第 N 批时这里继续为第 N+1 批做映射和分配
+    bool streaming = size >= 2 * STREAM_CHUNK_BLOCKS * BLOCK_SIZE;
+    bool direct = fi != NULL && (fi->fh & FH_DIRECT_IO);
+    bool nocache = node.policy & FSLAB_POLICY_NOCACHE;
+    direct = direct || nocache;
+    char *scratch = NULL;       // nocache 文件部分块的读-改-写缓冲区
+    int err = 0;
+    int chunk_blocks[STREAM_CHUNK_BLOCKS];
+    const char *chunk_data[STREAM_CHUNK_BLOCKS];
+    int chunk_n = 0;
+    // 已有的映射通过迭代器查询，只有空洞才走 get_block_num 分配
+    extent_iter_t it;
+    extent_iter_init(&it, &node, offset / BLOCK_SIZE, ceil_div(offset + size, BLOCK_SIZE));
+    while (done < size) {
+        int idx = (offset + done) / BLOCK_SIZE;
+        int off = (offset + done) % BLOCK_SIZE;
+        size_t n = min(BLOCK_SIZE - off, size - done);
+
+        // 追加写命中尾块时跳过块映射，也不需要 put
+        buf_t *bh = tail_lookup(inode_num, idx);
+        bool from_tail = bh != NULL;
+        if (!from_tail) {
+            uint32_t blocks_before = node.blocks;
+            int block = extent_iter_lookup(&it, idx);
+            if (block == 0) {
+                block = get_block_num(&node, idx, true);
+            }
+            if (block < 0) {
+                err = block;
+                break;
+            }
+            // 只有写入范围之外还有旧数据的部分块才需要读盘，
+            // 新分配的块、整块覆盖和覆盖了全部旧数据的块都直接清零后写入
+            bool fresh = node.blocks != blocks_before;
+            uint32_t block_start = (uint32_t)idx * BLOCK_SIZE;
+            uint32_t valid = old_size > block_start ? min(BLOCK_SIZE, old_size - block_start) : 0;
+            bool need_read = !fresh && valid > 0 && (off > 0 || off + n < valid);
+            if (fresh) {
+                write_stats.hole_fills++;
+            } else if (off == 0 && n == BLOCK_SIZE) {
+                write_stats.full_overwrites++;
+            } else if (off > 0) {
+                write_stats.partial_heads++;
+            } else {
+                write_stats.partial_tails++;
+            }
+            if (need_read) {
+                write_stats.reads++;
+            } else {
+                write_stats.reads_avoided++;
+            }
+            if (streaming && n == BLOCK_SIZE && !cache_contains(block)) {
+                chunk_blocks[chunk_n] = block;
+                chunk_data[chunk_n] = buffer + done;
+                if (++chunk_n == STREAM_CHUNK_BLOCKS) {
+                    stream_submit(chunk_blocks, chunk_data, chunk_n);
+                    chunk_n = 0;
+                }
+                write_stats.streamed++;
+                last = NULL;
+                done += n;
+                continue;
+            }
+            // 直接 I/O 的整块写：缓存里没有这一块就直接写盘，有则仍写缓存以免两份不一致
+            if (direct && n == BLOCK_SIZE && !cache_contains(block)) {
+                if (write_uncached(block, buffer + done) != 0) {
+                    err = -EIO;
+                    break;
+                }
+                direct_stats.writes++;
+                last = NULL;
+                done += n;
+                continue;
+            }
+            // nocache 文件的部分块在 arena 中读-改-写，同样不进入块缓存
+            if (nocache && !cache_contains(block)) {
+                if (scratch == NULL) scratch = arena_alloc(BLOCK_SIZE);
+                if (scratch == NULL) {
+                    err = -ENOMEM;
+                    break;
+                }
+                if (!need_read) {
+                    memset(scratch, 0, BLOCK_SIZE);
+                } else if (read_uncached(block, scratch) != 0) {
+                    err = -EIO;
+                    break;
+                }
+                memcpy(scratch + off, buffer + done, n);
+                if (write_uncached(block, scratch) != 0) {
+                    err = -EIO;
+                    break;
+                }
+                direct_stats.writes++;
+                last = NULL;
+                done += n;
+                continue;
+            }
+            bh = need_read ? cache_get(block) : cache_get_zeroed(block);
+            if (bh == NULL) {
+                err = -EIO;
+                break;
+            }
+        }
+        memcpy(bh->data + off, buffer + done, n);
+        cache_mark_dirty(bh);
+        if (!from_tail) {
+            cache_put(bh);
+        }
+        last = bh;
+        done += n;
+    }
+    extent_iter_done(&it);
+    if (err != 0 && done == 0) {
+        // 一个字节也没写成，但可能已经为空洞分配了块，inode 仍要写回，否则这些块在位图中泄漏
+        write_inode(inode_num, &node);
+        update_usage(node.parent, 0, (int64_t)node.blocks - old_blocks, 0);
+        return err;
+    }
+    if (chunk_n > 0) {
+        stream_submit(chunk_blocks, chunk_data, chunk_n);
+    }
+    // buffer 在返回前必须一直有效，所以这里等待本次提交的写全部完成
+    int stream_status = streaming ? stream_wait() : 0;
+
+    uint32_t end = offset + done;
+    if (end > node.size) {
+        node.size = end;
+    }
+    // 写到文件末尾且尾块未满时，把尾块留在缓存中供下一次追加（nocache 文件除外）
+    if (last != NULL && end == node.size && end % BLOCK_SIZE != 0 && !(node.policy & FSLAB_POLICY_NOCACHE)) {
+        tail_remember(inode_num, (end - 1) / BLOCK_SIZE, last);
+    } else if (end == node.size) {
+        tail_forget(inode_num);
+    }
+
+    update_timestamp(&node, false, true, true);
+    write_inode(inode_num, &node);
+    update_usage(node.parent, (int64_t)node.size - old_size, (int64_t)node.blocks - old_blocks, 0);
+    if ((node.policy & FSLAB_POLICY_WRITETHROUGH) &&
+        sync_file(inode_num, &node, offset / BLOCK_SIZE, ceil_div(end, BLOCK_SIZE)) != 0) {
+        stream_status = -1;
+    }
+    changelog_append(inode_num, node.parent, FSLAB_CHANGE_WRITE);
+    return stream_status != 0 ? -EIO : (int)done;
 }
 
 // 修改一个文件的大小（即分配或释放数据块）
@@ -402,7 +974,47 @@ int fs_write(const char* path, const char* buffer, size_t size, off_t offset, st
 // 3. 修改 inode 的 ctime
 int fs_truncate(const char* path, off_t size) {
     fs_info("fs_truncate is called:%s\tsize:%d\n", path, size);
+    REQUEST_BEGIN(PERF_TRUNCATE);
+
+    uint32_t inode_num;
+    inode_t node;
+    if (find_inode_by_path(path, &inode_num) != 0 || read_inode(inode_num, &node) != 0) {
+        return -ENOENT;
+    }
+    if (S_ISDIR(node.mode)) {
+        return -EISDIR;
+    }
+    if (size < 0) {
+        return -EINVAL;
+    }
+    if (size > MAX_FILE_SIZE) {
+        return -EFBIG;
+    }
+
+    uint32_t old_size = node.size, old_blocks = node.blocks;
+    // 缩小时保留的最后一块被部分清零，扩大时新增的空洞读出来是 0，两种情况下这段区间都变了
+    cbt_mark(&node, min((uint32_t)size, node.size) / BLOCK_SIZE, ceil_div(max((uint32_t)size, node.size), BLOCK_SIZE));
+    if (size < node.size) {
+        tail_forget(inode_num);
+        int keep = ceil_div(size, BLOCK_SIZE);
+        free_blocks_from(&node, keep);
+        // 保留的最后一块中新末尾之后的部分清零，以后扩展文件时读到的都是 0
+        int off = size % BLOCK_SIZE;
+        int block = off ? get_block_num(&node, keep - 1, false) : 0;
+        buf_t *bh;
+        if (block > 0 && (bh = cache_get(block)) != NULL) {
+            memset(bh->data + off, 0, BLOCK_SIZE - off);
+            cache_mark_dirty(bh);
+            cache_put(bh);
+        }
+    }
+    // 扩大时不分配数据块，新增部分是空洞
+    node.size = size;
 
+    update_timestamp(&node, false, true, true);
+    write_inode(inode_num, &node);
+    update_usage(node.parent, (int64_t)node.size - old_size, (int64_t)node.blocks - old_blocks, 0);
+    changelog_append(inode_num, node.parent, FSLAB_CHANGE_TRUNCATE);
     return 0;
 }
 
@@ -414,6 +1026,7 @@ int fs_truncate(const char* path, off_t size) {
 // 3. 更新 inode 的 ctime（因为 utimens 本身修改了元数据）
 int fs_utimens(const char* path, const struct timespec tv[2]) {
     fs_info("fs_utimens is called:%s\n", path);
+    REQUEST_BEGIN(PERF_UTIMENS);
 
     return 0;
 }
@@ -425,6 +1038,7 @@ int fs_utimens(const char* path, const struct timespec tv[2]) {
 // `df mnt` 和 `df -i mnt` 会触发这个函数
 int fs_statfs(const char* path, struct statvfs* stat) {
     fs_info("fs_statfs is called:%s\n", path);
+    REQUEST_BEGIN(PERF_STATFS);
 
     *stat = (struct statvfs){
         .f_bsize = 0,   // 块大小（字节记）
@@ -450,20 +1064,61 @@ int fs_statfs(const char* path, struct statvfs* stat) {
 // 不考虑 `fs->fh` 时，这个函数事实上可以什么都不干
 int fs_open(const char* path, struct fuse_file_info* fi) {
     fs_info("fs_open is called:%s\tflag:%o\n", path, fi->flags);
+    REQUEST_BEGIN(PERF_OPEN);
+
+    uint32_t inode_num;
+    inode_t node;
+    if (find_inode_by_path(path, &inode_num) != 0 || read_inode(inode_num, &node) != 0) {
+        return -ENOENT;
+    }
 
+    fi->fh = 0;
+    bool direct = (fi->flags & O_DIRECT) || (node.policy & FSLAB_POLICY_NOCACHE);
+    if (!direct && mount_direct_io && !(node.policy & FSLAB_POLICY_WRITEBACK)) {
+        // 只写打开（备份、日志转储）或者已经很大的文件按流式访问处理
+        direct = (fi->flags & O_ACCMODE) == O_WRONLY || node.size >= DIRECT_IO_MIN_SIZE;
+    }
+    if (direct) {
+        fi->direct_io = 1;
+        fi->fh |= FH_DIRECT_IO;
+        direct_stats.opens++;
+    }
     return 0;
 }
 
-// 会在一个文件被关闭时被调用，你可以在这里做相对于 `fs_open` 的一些清理工作
+// 每次 close() 一个文件描述符时被调用，close() 会等待它完成并返回它的错误码
+//
+// sync-on-close 策略在这里把文件的脏块写回磁盘，写回失败时 close() 返回 EIO
+int fs_flush(const char* path, struct fuse_file_info* fi) {
+    fs_info("fs_flush is called:%s\n", path);
+    REQUEST_BEGIN(PERF_FLUSH);
+
+    uint32_t inode_num;
+    inode_t node;
+    if (find_inode_by_path(path, &inode_num) != 0 || read_inode(inode_num, &node) != 0) {
+        return 0; // 文件可能已经被删除
+    }
+    if ((node.policy & FSLAB_POLICY_SYNC_ON_CLOSE) &&
+        sync_file(inode_num, &node, 0, ceil_div(node.size, BLOCK_SIZE)) != 0) {
+        return -EIO;
+    }
+    return 0;
+}
+
+// 会在一个文件的最后一个描述符被关闭后异步调用，返回值会被忽略，
+// 只用来清理 `fs_open` 建立的每个打开实例的状态，写回放在 `fs_flush` 中
 int fs_release(const char* path, struct fuse_file_info* fi) {
     fs_info("fs_release is called:%s\n", path);
+    REQUEST_BEGIN(PERF_RELEASE);
 
+    fi->fh = 0;
     return 0;
 }
 
 // 类似于 `fs_open`，本实验中可以不做任何处理
 int fs_opendir(const char* path, struct fuse_file_info* fi) {
     fs_info("fs_opendir is called:%s\n", path);
+    REQUEST_BEGIN(PERF_OPENDIR);
 
     return 0;
 }
@@ -471,40 +1126,180 @@ int fs_opendir(const char* path, struct fuse_file_info* fi) {
 // 类似于 `fs_release`，本实验中可以不做任何处理
 int fs_releasedir(const char* path, struct fuse_file_info* fi) {
     fs_info("fs_releasedir is called:%s\n", path);
+    REQUEST_BEGIN(PERF_RELEASEDIR);
 
     return 0;
 }
 
+// 读取扩展属性
+//
+// `user.fslab.usage`：返回以该条目为根的子树的字节数、数据块数和条目数，
+// 这些统计在每次修改时沿祖先链增量维护，所以查询是 O(1) 的
+// `user.fslab.policy`：返回逗号分隔的策略名，没有设置策略时为空
+// `user.fslab.heatmap`：返回整个设备的块访问热度图（任意路径上都可以读取），格式见 heat.h
+//
+// `getfattr -n user.fslab.usage dir` 会触发这个函数
+int fs_getxattr(const char* path, const char* name, char* value, size_t size) {
+    fs_info("fs_getxattr is called:%s\tname:%s\n", path, name);
+    REQUEST_BEGIN(PERF_GETXATTR);
+
+    uint32_t inode_num;
+    inode_t node;
+    if (find_inode_by_path(path, &inode_num) != 0 || read_inode(inode_num, &node) != 0) {
+        return -ENOENT;
+    }
+    char text[96];
+    int len;
+    if (strcmp(name, "user.fslab.usage") == 0) {
+        int64_t bytes, blocks, files;
+        usage_of(&node, &bytes, &blocks, &files);
+        len = snprintf(text, sizeof(text), "bytes=%lld blocks=%lld files=%lld",
+                       (long long)bytes, (long long)blocks, (long long)files);
+    } else if (strcmp(name, "user.fslab.policy") == 0) {
+        len = policy_format(node.policy, text, sizeof(text));
+    } else if (strcmp(name, "user.fslab.heatmap") == 0) {
+        // 扩展属性的值不带 \0，先按 len + 1 格式化到 arena 中再复制 len 字节
+        len = heat_format(NULL, 0);
+        if (size == 0) return len;
+        if (size < (size_t)len) return -ERANGE;
+        char *buf = arena_alloc(len + 1);
+        if (buf == NULL) return -ENOMEM;
+        heat_format(buf, len + 1);
+        memcpy(value, buf, len);
+        return len;
+    } else {
+        return -ENODATA;
+    }
+    if (size == 0) return len;
+    if (size < (size_t)len) return -ERANGE;
+    memcpy(value, text, len);
+    return len;
+}
+
+// 设置扩展属性
+//
+// 只支持 `user.fslab.policy`，值为逗号分隔的策略名（nocache、writeback、writethrough、
+// sync-on-close、sequential），空值清除全部策略
+//
+// `setfattr -n user.fslab.policy -v nocache,sync-on-close file` 会触发这个函数
+int fs_setxattr(const char* path, const char* name, const char* value, size_t size, int flags) {
+    fs_info("fs_setxattr is called:%s\tname:%s\n", path, name);
+    REQUEST_BEGIN(PERF_SETXATTR);
+
+    uint32_t inode_num;
+    inode_t node;
+    if (find_inode_by_path(path, &inode_num) != 0 || read_inode(inode_num, &node) != 0) {
+        return -ENOENT;
+    }
+    if (strcmp(name, "user.fslab.policy") != 0) {
+        return -ENOTSUP;
+    }
+    uint32_t policy;
+    if (policy_parse(value, size, &policy) != 0) {
+        return -EINVAL;
+    }
+    return set_policy(inode_num, &node, policy);
+}
+
+// 文件上的 ioctl
+//
+// FSLAB_IOC_EXTENTS：返回文件某个范围内的数据块分布（逻辑偏移、物理偏移、长度、是否空洞），
+// 工具可以据此查看碎片和空洞，定义见 fslab_ioctl.h
+// FSLAB_IOC_GET_POLICY / FSLAB_IOC_SET_POLICY：读写文件的策略，和 user.fslab.policy 等价
+int fs_ioctl(const char* path, int cmd, void* arg, struct fuse_file_info* fi, unsigned int flags, void* data) {
+    fs_info("fs_ioctl is called:%s\tcmd:%x\n", path, cmd);
+    REQUEST_BEGIN(PERF_IOCTL);
+
+    uint32_t inode_num;
+    inode_t node;
+    if (find_inode_by_path(path, &inode_num) != 0 || read_inode(inode_num, &node) != 0) {
+        return -ENOENT;
+    }
+
+    switch ((unsigned int)cmd) {
+    case FSLAB_IOC_EXTENTS: {
+        struct fslab_extent_query *q = data;
+        uint64_t end = query_end(q->start, q->length, node.size);
+        q->count = 0;
+        if (q->start >= end) return 0;
+
+        extent_iter_t it;
+        extent_t ext;
+        extent_iter_init(&it, &node, q->start / BLOCK_SIZE, ceil_div(end, BLOCK_SIZE));
+        while (q->count < FSLAB_EXTENT_MAX && extent_iter_next(&it, &ext)) {
+            struct fslab_extent *e = &q->extents[q->count++];
+            e->logical = (uint64_t)ext.logical * BLOCK_SIZE;
+            e->physical = (uint64_t)ext.physical * BLOCK_SIZE;
+            e->length = (uint64_t)ext.length * BLOCK_SIZE;
+            e->flags = ext.flags;
+            e->reserved = 0;
+        }
+        extent_iter_done(&it);
+        return 0;
+    }
+    case FSLAB_IOC_GET_POLICY:
+        *(uint32_t *)data = node.policy;
+        return 0;
+    case FSLAB_IOC_SET_POLICY:
+        return set_policy(inode_num, &node, *(uint32_t *)data);
+    case FSLAB_IOC_SCAN_INODES:
+        return scan_inodes(data);
+    case FSLAB_IOC_CHECKPOINT:
+        if (S_ISDIR(node.mode)) return -EISDIR;
+        return cbt_checkpoint(inode_num, &node);
+    case FSLAB_IOC_CHANGED_RANGES:
+        return cbt_ranges(&node, data);
+    case FSLAB_IOC_INODE_PATH: {
+        struct fslab_inode_path *q = data;
+        return inode_to_path(q->ino, q->path, sizeof(q->path));
+    }
+    case FSLAB_IOC_READ_CHANGES:
+        if (!changelog_enabled()) return -EOPNOTSUPP;
+        changelog_read(data);
+        return 0;
+    default:
+        return -ENOTTY;
+    }
+}
+
 // ---- 辅助函数实现 ----
 
-int read_inode(int inode_num, inode_t *inode) {
-    if (inode_num >= INODE_COUNT) {
-        return -1; // 索引越界
+// 返回 inode 在缓存块中的指针，调用者用完后需要 cache_put(*handle)，
+// 修改后需要 cache_mark_dirty(*handle)
+inode_t *get_inode(int inode_num, buf_t **handle) {
+    if (inode_num < 0 || inode_num >= sb.num_inodes) {
+        return NULL; // 索引越界
     }
-    int block_num = INODE_TABLE_START_BLOCK + (inode_num / INODES_PER_BLOCK);
+    int block_num = inode_table_block(inode_num / INODES_PER_BLOCK);
     int offset_in_block = inode_num % INODES_PER_BLOCK;
-    char block[BLOCK_SIZE];
-    if(disk_read(block_num, block) != 0){
+    buf_t *bh = block_num > 0 ? cache_get_meta(block_num) : NULL;
+    if (bh == NULL) {
+        return NULL;
+    }
+    *handle = bh;
+    return (inode_t *)(bh->data + offset_in_block * INODE_SIZE);
+}
+
+int read_inode(int inode_num, inode_t *inode) {
+    buf_t *bh;
+    inode_t *p = get_inode(inode_num, &bh);
+    if (p == NULL) {
         return -1;
     }
-    memcpy(inode, block + offset_in_block * INODE_SIZE, INODE_SIZE);
+    *inode = *p;
+    cache_put(bh);
     return 0;
 }
 
 int write_inode(int inode_num, const inode_t *inode) {
-    if (inode_num >= INODE_COUNT) {
-        return -1;
-    }
-    int block_num = INODE_TABLE_START_BLOCK + (inode_num / INODES_PER_BLOCK);
-    int offset_in_block = inode_num % INODES_PER_BLOCK;
-    char block[BLOCK_SIZE];
-    if(disk_read(block_num, block) != 0){
-        return -1;
-    }
-    memcpy(block + offset_in_block * INODE_SIZE, inode, INODE_SIZE);
-    if(disk_write(block_num, block) != 0){
+    buf_t *bh;
+    inode_t *p = get_inode(inode_num, &bh);
+    if (p == NULL) {
         return -1;
     }
+    *p = *inode;
+    cache_mark_dirty(bh);
+    cache_put(bh);
     return 0;
 }
 
@@ -523,9 +1318,11 @@ uint32_t get_directory_block_addr(struct inode *dir_inode, uint32_t block_index)
         uint32_t indirect_block_addr = dir_inode->indirect_block_pointer[indirect_group];
         if (indirect_block_addr == 0) return 0;
 
-        uint32_t pointers[pointers_per_block];
-        if (disk_read(indirect_block_addr, pointers) != 0) return 0;
-        return pointers[indirect_offset];
+        buf_t *bh = cache_get(indirect_block_addr);
+        if (bh == NULL) return 0;
+        uint32_t addr = ((uint32_t *)bh->data)[indirect_offset];
+        cache_put(bh);
+        return addr;
     }
     
     return 0; // 超出范围
@@ -535,25 +1332,58 @@ int find_entry_in_directory(struct inode *dir_inode, const char *name, uint32_t
         return -1;
     }
 
-    dir_entry_t dir_block[ENTRIES_PER_BLOCK];
     uint32_t num_blocks_to_check = ceil_div(dir_inode->size, BLOCK_SIZE);
 
     for (uint32_t i = 0; i < num_blocks_to_check; i++) {
         uint32_t block_addr = get_directory_block_addr(dir_inode, i);
-        if (block_addr == 0 || disk_read(block_addr, dir_block) != 0) {
+        buf_t *bh;
+        if (block_addr == 0 || (bh = cache_get_meta(block_addr)) == NULL) {
             continue; // 跳过稀疏块或读取失败的块
         }
 
+        dir_entry_t *dir_block = (dir_entry_t *)bh->data;
         for (int j = 0; j < ENTRIES_PER_BLOCK; j++) {
             if (dir_block[j].inode_num != 0 && strcmp(dir_block[j].name, name) == 0) {
                 *inode_index = dir_block[j].inode_num;
+                cache_put(bh);
                 return 0; // 成功找到，立即返回
             }
         }
+        cache_put(bh);
     }
 
     return -1; // 遍历完成仍未找到
 }
+// 解析 path 的父目录，成功时把父目录 inode 编号写入 *parent_inode_num，
+// 最后一级文件名写入 filename（至少 MAX_FILENAME_LEN + 1 字节）
+int get_inode_by_path(const char *path, int *parent_inode_num, char *filename) {
+    if (path == NULL || path[0] != '/' || strcmp(path, "/") == 0) {
+        return -EINVAL;
+    }
+    char *path_copy = arena_strdup(path);
+    if (!path_copy) return -ENOMEM;
+
+    size_t len = strlen(path_copy);
+    while (len > 1 && path_copy[len - 1] == '/') {
+        path_copy[--len] = '\0';
+    }
+    char *slash = strrchr(path_copy, '/');
+    if (strlen(slash + 1) > MAX_FILENAME_LEN) {
+        return -ENAMETOOLONG;
+    }
+
+    uint32_t parent = 0;
+    if (slash != path_copy) {
+        *slash = '\0';
+        if (find_inode_by_path(path_copy, &parent) != 0) {
+            return -ENOENT;
+        }
+    }
+    strcpy(filename, slash + 1);
+    *parent_inode_num = parent;
+    return 0;
+}
+
 // 根据路径获取 inode 编号
 int find_inode_by_path(const char *path, uint32_t *inode_index) {
     if (path == NULL || path[0] != '/') {
@@ -564,7 +1394,7 @@ int find_inode_by_path(const char *path, uint32_t *inode_index) {
         *inode_index = 0;
         return 0;
     }
-    char *path_copy = strdup(path);
+    char *path_copy = arena_strdup(path);
     if (!path_copy) return -1;
 
     uint32_t current_ino = 0;
@@ -589,61 +1419,993 @@ int find_inode_by_path(const char *path, uint32_t *inode_index) {
         status = 0; // 只有在完全成功时才设置状态为0
     }
 
-    free(path_copy); // 统一释放资源
-    return status;
+    return status; // path_copy 在 arena 中，随请求结束回收
 }
 
-int alloc_inode() {//1
-    char bitmap[BLOCK_SIZE];
-    disk_read(INODE_BITMAP_BLOCK, bitmap);
-    for (int i = 0; i < sb.num_inodes; ++i) {
-        if (!((bitmap[i / 8] >> (i % 8)) & 1)) {
-            bitmap[i / 8] |= (1 << (i % 8));
-            disk_write(INODE_BITMAP_BLOCK, bitmap);
-            return i;
+// 向两侧扩展时最多检查的 inode 表块数，之后在整个位图中线性查找
+#define ALLOC_INODE_RADIUS 64
+
+// 优先分配与父目录位于同一个 inode 表块中的空闲 inode（兄弟条目也因此聚在一起），
+// 否则从该块向两侧交替扩展，这样同一目录下的 stat 只会访问少数几个 inode 表块。
+// inode 位图在整个查找期间只固定一次
+int alloc_inode(int parent_inode_num) {//1
+    buf_t *maps[INODE_BITMAP_BLOCKS];
+    int nmaps = ceil_div(sb.num_inodes, (int)BITMAP_BITS_PER_BLOCK);
+    for (int k = 0; k < nmaps; ++k) {
+        if ((maps[k] = cache_get_meta(INODE_BITMAP_BLOCK + k)) == NULL) {
+            while (k-- > 0) cache_put(maps[k]);
+            return -EIO;
         }
     }
-    return -ENOSPC;
+    int home = parent_inode_num / INODES_PER_BLOCK;
+    int i = -1;
+    for (int d = 0; d < 2 * ALLOC_INODE_RADIUS + 1 && i < 0; ++d) {
+        int t = (d & 1) ? home + (d + 1) / 2 : home - d / 2;
+        if (t < 0 || t >= sb.inode_table_blocks) continue;
+        int last = min((t + 1) * (int)INODES_PER_BLOCK, sb.num_inodes);
+        i = bitmap_find_zero(maps, t * INODES_PER_BLOCK, last);
+    }
+    if (i < 0) i = bitmap_find_zero(maps, 0, sb.num_inodes);
+    if (i >= 0) {
+        buf_t *bh = maps[i / BITMAP_BITS_PER_BLOCK];
+        int bit = i % BITMAP_BITS_PER_BLOCK;
+        bh->data[bit / 8] |= (1 << (bit % 8));
+        cache_mark_dirty(bh);
+    }
+    for (int k = 0; k < nmaps; ++k) cache_put(maps[k]);
+    if (i < 0) return -ENOSPC;
+
+    int t = i / INODES_PER_BLOCK;
+    if (inode_table_block(t) == 0 && alloc_inode_chunk(t) != 0) {
+        free_inode(i);
+        return -ENOSPC;
+    }
+    return i;
+}
+
+// 第 t 个 inode 表块的块号，动态格式下尚未分配时返回 0
+int inode_table_block(int t) {
+    if (sb.flags & SB_DYNAMIC_INODES) {
+        return t < (int)INODE_CHUNKS_MAX ? (int)inode_chunk_map[t] : 0;
+    }
+    return INODE_TABLE_START_BLOCK + t;
+}
+
+// 动态格式下为第 t 个 inode 表块分配一个清零的数据块并记入映射
+int alloc_inode_chunk(int t) {
+    int b = alloc_data_block();
+    if (b < 0) return b;
+    buf_t *bh = cache_get_zeroed(b);
+    buf_t *map = cache_get_meta(INODE_CHUNK_MAP_BLOCK);
+    if (bh == NULL || map == NULL) {
+        cache_put(bh);
+        cache_put(map);
+        free_data_block(b);
+        return -EIO;
+    }
+    cache_mark_meta(bh);
+    cache_put(bh);
+    inode_chunk_map[t] = b;
+    ((uint32_t *)map->data)[t] = b;
+    cache_mark_dirty(map);
+    cache_put(map);
+    return 0;
+}
+
+// 从 q->next 开始按顺序读取已分配的 inode，直到填满一批或者到达 inode 表末尾
+//
+// 每个 inode 表块只读一次，位图中对应范围全空的块（包括动态格式下尚未分配的块）不读
+int scan_inodes(struct fslab_inode_scan *q) {
+    uint32_t i = q->next;
+    q->count = 0;
+    q->flags = 0;
+    while (i < (uint32_t)sb.num_inodes && q->count < FSLAB_SCAN_MAX) {
+        // 一次处理同一个 inode 表块、同一个位图块中的一段
+        uint32_t last = min((i / INODES_PER_BLOCK + 1) * INODES_PER_BLOCK, (uint32_t)sb.num_inodes);
+        last = min(last, (i / BITMAP_BITS_PER_BLOCK + 1) * BITMAP_BITS_PER_BLOCK);
+        buf_t *map = cache_get_meta(INODE_BITMAP_BLOCK + i / BITMAP_BITS_PER_BLOCK);
+        if (map == NULL) return -EIO;
+        buf_t *table = NULL;
+        for (; i < last && q->count < FSLAB_SCAN_MAX; ++i) {
+            int bit = i % BITMAP_BITS_PER_BLOCK;
+            if (!((map->data[bit / 8] >> (bit % 8)) & 1)) continue;
+            if (table == NULL) {
+                int block = inode_table_block(i / INODES_PER_BLOCK);
+                if (block <= 0 || (table = cache_get_meta(block)) == NULL) {
+                    cache_put(map);
+                    return -EIO;
+                }
+            }
+            const inode_t *p = (const inode_t *)(table->data + (i % INODES_PER_BLOCK) * INODE_SIZE);
+            q->inodes[q->count++] = (struct fslab_inode_rec){
+                .ino = i,
+                .mode = p->mode,
+                .parent = p->parent,
+                .size = p->size,
+                .atime = p->atime,
+                .mtime = p->mtime,
+                .ctime = p->ctime,
+                .blocks = p->blocks,
+            };
+        }
+        cache_put(table);
+        cache_put(map);
+    }
+    q->next = i;
+    if (i >= (uint32_t)sb.num_inodes) q->flags |= FSLAB_SCAN_END;
+    return 0;
 }
 
 void free_inode(int inode_num) {
-    char bitmap[BLOCK_SIZE];
-    disk_read(INODE_BITMAP_BLOCK, bitmap);
-    bitmap[inode_num/8] &= ~(1 << (inode_num % 8));
-    disk_write(INODE_BITMAP_BLOCK, bitmap);
-}
-
-// // 在父目录中添加一个条目
-// int add_dir_entry(inode_t *parent_inode, int parent_inode_num, const char *filename, int new_inode_num) {
-//     dir_entry_t new_entry;
-//     strncpy(new_entry.name, filename, MAX_FILENAME_LEN);
-//     new_entry.name[MAX_FILENAME_LEN] = '\0';
-//     new_entry.inode_num = new_inode_num;
-
-//     // 遍历父目录的数据块寻找空位
-//     // ... 此处需要一个完整的实现
-//     // 如果没有空位，需要通过 get_block_num 分配新块
-    
-//     // 简化版：假设总是在末尾添加
-//     int block_idx = parent_inode->size / BLOCK_SIZE;
-//     int offset = parent_inode->size % BLOCK_SIZE;
-    
-//     if (offset == 0) { // 需要新块
-//         int new_block = get_block_num(parent_inode, block_idx, true);
-//         if (new_block < 0) return -ENOSPC;
-//         write_inode(parent_inode_num, parent_inode); // get_block_num 可能修改了 inode
-//     }
+    bitmap_clear(INODE_BITMAP_BLOCK, inode_num);
+}
+
+static int cmp_int(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+// 按块号排序后一次性预读 inode 表块，使随后的 getattr 全部命中缓存
+void prefetch_inode_blocks(int *blocks, int n) {
+    if (blocks == NULL || n == 0) return;
+    qsort(blocks, n, sizeof(int), cmp_int);
+    cache_prefetch(blocks, n);
+}
+
+// 记录 inode_num 所在的 inode 表块（去重），用于随后的 prefetch_inode_blocks
+void note_inode_block(char *seen, int *blocks, int *n, uint32_t inode_num) {
+    int t = inode_num / INODES_PER_BLOCK;
+    if (seen && blocks && t < sb.inode_table_blocks && !seen[t] && inode_table_block(t) > 0) {
+        seen[t] = 1;
+        blocks[(*n)++] = inode_table_block(t);
+    }
+}
+
+// 扫描目录块建立 readdir 快照，目录过大时返回 NULL
+//
+// 第一遍收集子条目所在的 inode 表块并批量预读，第二遍读取子条目类型写入快照
+dirsnap_t *build_dirsnap(uint32_t inode_num, inode_t *dir_inode) {
+    uint32_t num_blocks = ceil_div(dir_inode->size, BLOCK_SIZE);
+    char *seen = arena_alloc(sb.inode_table_blocks);
+    int *table_blocks = arena_alloc(sb.inode_table_blocks * sizeof(int));
+    int num_table_blocks = 0;
+    if (seen) memset(seen, 0, sb.inode_table_blocks);
+
+    for (int pass = 0; pass < 2; ++pass) {
+        dirsnap_t *snap = pass ? dirsnap_new(inode_num) : NULL;
+        for (uint32_t i = 0; i < num_blocks; i++) {
+            uint32_t block_addr = get_directory_block_addr(dir_inode, i);
+            buf_t *bh;
+            if (block_addr == 0 || (bh = cache_get_meta(block_addr)) == NULL) {
+                continue;
+            }
+            dir_entry_t *entries = (dir_entry_t *)bh->data;
+            for (int j = 0; j < ENTRIES_PER_BLOCK; j++) {
+                if (entries[j].inode_num == 0) continue;
+                if (pass == 0) {
+                    note_inode_block(seen, table_blocks, &num_table_blocks, entries[j].inode_num);
+                    continue;
+                }
+                inode_t child;
+                if (read_inode(entries[j].inode_num, &child) != 0 ||
+                    dirsnap_append(snap, entries[j].name, entries[j].inode_num, child.mode) != 0) {
+                    cache_put(bh);
+                    dirsnap_drop(inode_num);
+                    return NULL;
+                }
+            }
+            cache_put(bh);
+        }
+        if (pass == 0) {
+            prefetch_inode_blocks(table_blocks, num_table_blocks);
+        } else {
+            return snap;
+        }
+    }
+    return NULL;
+}
 
-//     // 更新大小并写入
-//     parent_inode->size += sizeof(dir_entry_t);
-//     // ... (将 new_entry 写入到正确的块和偏移)
+// 在从 start_block 开始的位图中查找 [lo, hi) 内第一个空闲位并置位，返回位号，
+// 没有空闲位返回 -ENOSPC，位图块校验失败返回 -EIO
+int bitmap_alloc(int start_block, int lo, int hi) {
+    int i = lo;
+    while (i < hi) {
+        buf_t *bh = cache_get_meta(start_block + i / BITMAP_BITS_PER_BLOCK);
+        if (bh == NULL) return -EIO;
+        unsigned char *bitmap = (unsigned char *)bh->data;
+        int end = min((i / BITMAP_BITS_PER_BLOCK + 1) * BITMAP_BITS_PER_BLOCK, hi);
+        for (; i < end; ++i) {
+            int bit = i % BITMAP_BITS_PER_BLOCK;
+            if (bit % 8 == 0 && bitmap[bit / 8] == 0xff && i + 8 <= end) {
+                i += 7; // 整个字节都已占用
+                continue;
+            }
+            if (!((bitmap[bit / 8] >> (bit % 8)) & 1)) {
+                bitmap[bit / 8] |= (1 << (bit % 8));
+                cache_mark_dirty(bh);
+                cache_put(bh);
+                return i;
+            }
+        }
+        cache_put(bh);
+    }
+    return -ENOSPC;
+}
 
-//     return 0;
-// }
+// 在已固定的位图块 maps 中查找 [lo, hi) 内第一个空闲位，不置位，没有返回 -1。
+// 一次检查 64 位：位 i 在字节 i / 8 的第 i % 8 位，按小端读出的字中就是第 i % 64 位
+int bitmap_find_zero(buf_t *const *maps, int lo, int hi) {
+    while (lo < hi) {
+        const unsigned char *bitmap = (const unsigned char *)maps[lo / BITMAP_BITS_PER_BLOCK]->data;
+        int base = lo - lo % BITMAP_BITS_PER_BLOCK;
+        int end = min(base + (int)BITMAP_BITS_PER_BLOCK, hi) - base;
+        for (int bit = lo - base; bit < end;) {
+            int word_end = (bit / 64 + 1) * 64;
+            uint64_t w;
+            memcpy(&w, bitmap + bit / 64 * 8, sizeof(w)); // 最后一个字会读到校验和，下面被屏蔽
+            w = ~w & (~0ULL << (bit % 64));
+            if (end < word_end) w &= (1ULL << (end % 64)) - 1;
+            if (w != 0) return base + bit / 64 * 64 + __builtin_ctzll(w);
+            bit = word_end;
+        }
+        lo = base + end;
+    }
+    return -1;
+}
+
+void bitmap_clear(int start_block, int i) {
+    buf_t *bh = cache_get_meta(start_block + i / BITMAP_BITS_PER_BLOCK);
+    if (bh == NULL) return;
+    int bit = i % BITMAP_BITS_PER_BLOCK;
+    bh->data[bit / 8] &= ~(1 << (bit % 8));
+    cache_mark_dirty(bh);
+    cache_put(bh);
+}
+
+// 下一次分配数据块时开始搜索的位置（相对数据区起点）
+static int data_alloc_hint;
+
+// 分配一个数据块，返回其块号，没有空间时返回 -ENOSPC
+int alloc_data_block() {
+    int i = bitmap_alloc(DATA_BITMAP_START_BLOCK, data_alloc_hint, sb.num_data_blocks);
+    if (i == -ENOSPC) {
+        i = bitmap_alloc(DATA_BITMAP_START_BLOCK, 0, data_alloc_hint);
+    }
+    if (i == -ENOSPC && pending_n > 0) {
+        // 空间不够时先完成推迟的释放
+        pending_free_run(-1);
+        i = bitmap_alloc(DATA_BITMAP_START_BLOCK, 0, sb.num_data_blocks);
+    }
+    if (i < 0) return i;
+    data_alloc_hint = (i + 1) % sb.num_data_blocks;
+    return sb.data_blocks_start + i;
+}
+
+void free_data_block(int block_num) {
+    int i = block_num - sb.data_blocks_start;
+    if (i < 0 || i >= sb.num_data_blocks) return;
+    bitmap_clear(DATA_BITMAP_START_BLOCK, i);
+}
+
+// 返回文件第 file_block_idx 块对应的磁盘块号，空洞返回 0
+// allocate 为 true 时为空洞分配新块（间接块会被清零），调用者负责写回 inode
+int get_block_num(inode_t *inode, int file_block_idx, bool allocate) {
+    if (file_block_idx < DIRECT_POINTERS) {
+        if (inode->direct_block_pointer[file_block_idx] == 0 && allocate) {
+            int b = alloc_data_block();
+            if (b < 0) return b;
+            inode->direct_block_pointer[file_block_idx] = b;
+            inode->blocks++;
+        }
+        return inode->direct_block_pointer[file_block_idx];
+    }
+
+    file_block_idx -= DIRECT_POINTERS;
+    int group = file_block_idx / POINTERS_PER_BLOCK;
+    int offset = file_block_idx % POINTERS_PER_BLOCK;
+    if (group >= INDIRECT_POINTERS) return -EFBIG;
+
+    if (inode->indirect_block_pointer[group] == 0) {
+        if (!allocate) return 0;
+        int b = alloc_data_block();
+        if (b < 0) return b;
+        buf_t *bh = cache_get_zeroed(b);
+        if (bh == NULL) {
+            free_data_block(b);
+            return -EIO;
+        }
+        cache_put(bh);
+        inode->indirect_block_pointer[group] = b;
+        inode->blocks++;
+    }
+
+    buf_t *bh = cache_get(inode->indirect_block_pointer[group]);
+    if (bh == NULL) return -EIO;
+    uint32_t *pointers = (uint32_t *)bh->data;
+    if (pointers[offset] == 0 && allocate) {
+        int b = alloc_data_block();
+        if (b < 0) {
+            cache_put(bh);
+            return b;
+        }
+        pointers[offset] = b;
+        cache_mark_dirty(bh);
+        inode->blocks++;
+    }
+    int addr = pointers[offset];
+    cache_put(bh);
+    return addr;
+}
+
+// 在父目录中添加一个条目，优先复用空槽，没有空槽时追加一个新块
+int add_dir_entry(inode_t *parent_inode, int parent_inode_num, const char *filename, int new_inode_num) {
+    uint32_t num_blocks = ceil_div(parent_inode->size, BLOCK_SIZE);
+    for (uint32_t i = 0; i < num_blocks; i++) {
+        uint32_t block_addr = get_directory_block_addr(parent_inode, i);
+        buf_t *bh;
+        if (block_addr == 0 || (bh = cache_get_meta(block_addr)) == NULL) {
+            continue;
+        }
+        dir_entry_t *entries = (dir_entry_t *)bh->data;
+        for (int j = 0; j < ENTRIES_PER_BLOCK; j++) {
+            if (entries[j].inode_num == 0) {
+                memset(entries[j].name, 0, sizeof(entries[j].name));
+                strncpy(entries[j].name, filename, MAX_FILENAME_LEN);
+                entries[j].inode_num = new_inode_num;
+                cache_mark_dirty(bh);
+                cache_put(bh);
+                return 0;
+            }
+        }
+        cache_put(bh);
+    }
+
+    int block_addr = get_block_num(parent_inode, num_blocks, true);
+    if (block_addr < 0) return block_addr;
+    buf_t *bh = cache_get_zeroed(block_addr);
+    if (bh == NULL) return -EIO;
+    cache_mark_meta(bh);
+    dir_entry_t *entries = (dir_entry_t *)bh->data;
+    strncpy(entries[0].name, filename, MAX_FILENAME_LEN);
+    entries[0].inode_num = new_inode_num;
+    cache_put(bh);
+
+    parent_inode->size = (num_blocks + 1) * BLOCK_SIZE;
+    return write_inode(parent_inode_num, parent_inode);
+}
+
+// 在 path 处创建一个新的文件或目录，mknod 和 mkdir 共用
+int make_node(const char *path, uint32_t mode) {
+    int parent_num;
+    char filename[MAX_FILENAME_LEN + 1];
+    int ret = get_inode_by_path(path, &parent_num, filename);
+    if (ret != 0) return ret;
+
+    inode_t parent;
+    if (read_inode(parent_num, &parent) != 0) return -ENOENT;
+    if (!S_ISDIR(parent.mode)) return -ENOTDIR;
+    uint32_t existing;
+    if (find_entry_in_directory(&parent, filename, &existing) == 0) return -EEXIST;
+
+    int inode_num = alloc_inode(parent_num);
+    if (inode_num < 0) return inode_num;
+    inode_t node;
+    memset(&node, 0, sizeof(node));
+    node.mode = mode;
+    node.parent = parent_num;
+    node.policy = parent.policy; // 新条目继承所在目录的策略
+    if (S_ISDIR(mode)) {
+        node.tree_files = 1;
+    }
+    update_timestamp(&node, true, true, true);
+    if (write_inode(inode_num, &node) != 0) {
+        free_inode(inode_num);
+        return -EIO;
+    }
+
+    uint32_t old_size = parent.size, old_blocks = parent.blocks;
+    ret = add_dir_entry(&parent, parent_num, filename, inode_num);
+    if (ret != 0) {
+        free_inode(inode_num);
+        return ret;
+    }
+    dirsnap_add(parent_num, filename, inode_num, mode);
+    update_timestamp(&parent, false, true, true);
+    write_inode(parent_num, &parent);
+    update_usage(parent_num, (int64_t)parent.size - old_size, (int64_t)parent.blocks - old_blocks, 1);
+    changelog_append(inode_num, parent_num, FSLAB_CHANGE_CREATE);
+    return 0;
+}
+
+// 从目录中删除名为 name 的条目，被删除条目的 inode 编号写入 *inode_index
+int remove_dir_entry(inode_t *dir_inode, const char *name, uint32_t *inode_index) {
+    uint32_t num_blocks = ceil_div(dir_inode->size, BLOCK_SIZE);
+    for (uint32_t i = 0; i < num_blocks; i++) {
+        uint32_t block_addr = get_directory_block_addr(dir_inode, i);
+        buf_t *bh;
+        if (block_addr == 0 || (bh = cache_get_meta(block_addr)) == NULL) {
+            continue;
+        }
+        dir_entry_t *entries = (dir_entry_t *)bh->data;
+        for (int j = 0; j < ENTRIES_PER_BLOCK; j++) {
+            if (entries[j].inode_num != 0 && strcmp(entries[j].name, name) == 0) {
+                *inode_index = entries[j].inode_num;
+                memset(&entries[j], 0, sizeof(dir_entry_t));
+                cache_mark_dirty(bh);
+                cache_put(bh);
+                return 0;
+            }
+        }
+        cache_put(bh);
+    }
+    return -ENOENT;
+}
+
+bool dir_is_empty(inode_t *dir_inode) {
+    uint32_t num_blocks = ceil_div(dir_inode->size, BLOCK_SIZE);
+    for (uint32_t i = 0; i < num_blocks; i++) {
+        uint32_t block_addr = get_directory_block_addr(dir_inode, i);
+        buf_t *bh;
+        if (block_addr == 0 || (bh = cache_get_meta(block_addr)) == NULL) {
+            continue;
+        }
+        dir_entry_t *entries = (dir_entry_t *)bh->data;
+        for (int j = 0; j < ENTRIES_PER_BLOCK; j++) {
+            if (entries[j].inode_num != 0) {
+                cache_put(bh);
+                return false;
+            }
+        }
+        cache_put(bh);
+    }
+    return true;
+}
+
+// 删除一个文件或空目录，unlink 和 rmdir 共用
+int remove_node(const char *path, bool is_dir) {
+    int parent_num;
+    char filename[MAX_FILENAME_LEN + 1];
+    int ret = get_inode_by_path(path, &parent_num, filename);
+    if (ret != 0) return ret;
+
+    inode_t parent, node;
+    uint32_t inode_num;
+    if (read_inode(parent_num, &parent) != 0 ||
+        find_entry_in_directory(&parent, filename, &inode_num) != 0 ||
+        read_inode(inode_num, &node) != 0) {
+        return -ENOENT;
+    }
+    if (is_dir && !S_ISDIR(node.mode)) return -ENOTDIR;
+    if (!is_dir && S_ISDIR(node.mode)) return -EISDIR;
+    if (is_dir && !dir_is_empty(&node)) return -ENOTEMPTY;
+
+    int64_t bytes, blocks, files;
+    usage_of(&node, &bytes, &blocks, &files);
+
+    remove_dir_entry(&parent, filename, &inode_num);
+    dirsnap_remove(parent_num, filename);
+    if (is_dir) {
+        dirsnap_drop(inode_num);
+    } else {
+        tail_forget(inode_num);
+    }
+    free_all_data_blocks(&node);
+    node.parent = 0;
+    write_inode(inode_num, &node);
+    free_inode(inode_num);
+
+    update_timestamp(&parent, false, true, true);
+    write_inode(parent_num, &parent);
+    update_usage(parent_num, -bytes, -blocks, -files);
+    changelog_append(inode_num, parent_num, FSLAB_CHANGE_REMOVE);
+    return 0;
+}
+
+// 判断目录 ancestor 是否是 inode_num 自身或其祖先，沿父指针向上走，代价为 O(深度)
+bool is_ancestor(uint32_t ancestor, uint32_t inode_num) {
+    for (int depth = 0; depth < sb.num_inodes; ++depth) {
+        if (inode_num == ancestor) return true;
+        if (inode_num == 0) return false;
+        inode_t node;
+        if (read_inode(inode_num, &node) != 0) return false;
+        inode_num = node.parent;
+    }
+    return false;
+}
+
+// 由 inode 反查其绝对路径，沿父指针向上，每一级只扫描一个父目录
+int inode_to_path(uint32_t inode_num, char *buf, size_t size) {
+    if (size < 2) return -ERANGE;
+    size_t pos = size - 1;
+    buf[pos] = '\0';
+    while (inode_num != 0) {
+        inode_t node, parent;
+        if (read_inode(inode_num, &node) != 0 ||
+            read_inode(node.parent, &parent) != 0) {
+            return -ENOENT;
+        }
+        const char *name = NULL;
+        uint32_t num_blocks = ceil_div(parent.size, BLOCK_SIZE);
+        char found[MAX_FILENAME_LEN + 1];
+        for (uint32_t i = 0; i < num_blocks && name == NULL; i++) {
+            uint32_t block_addr = get_directory_block_addr(&parent, i);
+            buf_t *bh;
+            if (block_addr == 0 || (bh = cache_get_meta(block_addr)) == NULL) {
+                continue;
+            }
+            dir_entry_t *entries = (dir_entry_t *)bh->data;
+            for (int j = 0; j < ENTRIES_PER_BLOCK; j++) {
+                if (entries[j].inode_num == inode_num) {
+                    strncpy(found, entries[j].name, MAX_FILENAME_LEN);
+                    found[MAX_FILENAME_LEN] = '\0';
+                    name = found;
+                    break;
+                }
+            }
+            cache_put(bh);
+        }
+        if (name == NULL) return -ENOENT;
+        size_t len = strlen(name);
+        if (pos < len + 1) return -ERANGE;
+        pos -= len;
+        memcpy(buf + pos, name, len);
+        buf[--pos] = '/';
+        inode_num = node.parent;
+    }
+    if (pos == size - 1) buf[--pos] = '/';
+    memmove(buf, buf + pos, size - pos);
+    return 0;
+}
+
+// 一个条目计入父目录子树统计的量：目录取其子树统计，文件取自身
+void usage_of(const inode_t *node, int64_t *bytes, int64_t *blocks, int64_t *files) {
+    if (S_ISDIR(node->mode)) {
+        *bytes = node->tree_bytes;
+        *blocks = node->tree_blocks;
+        *files = node->tree_files;
+    } else {
+        *bytes = node->size;
+        *blocks = node->blocks;
+        *files = 1;
+    }
+}
+
+// 把增量加到目录 dir 及其所有祖先的子树统计上，原地修改缓存中的 inode，代价为 O(深度)
+void update_usage(uint32_t dir, int64_t dbytes, int64_t dblocks, int64_t dfiles) {
+    if (dbytes == 0 && dblocks == 0 && dfiles == 0) return;
+    for (int depth = 0; depth < sb.num_inodes; ++depth) {
+        buf_t *bh;
+        inode_t *p = get_inode(dir, &bh);
+        if (p == NULL) return;
+        p->tree_bytes += dbytes;
+        p->tree_blocks += dblocks;
+        p->tree_files += dfiles;
+        uint32_t parent = p->parent;
+        cache_mark_dirty(bh);
+        cache_put(bh);
+        if (dir == 0) return;
+        dir = parent;
+    }
+}
+
+// 把文件逻辑块 [first, end) 中的脏数据块、间接块和 inode 所在的块写回磁盘
+int sync_file(uint32_t inode_num, const inode_t *inode, uint32_t first, uint32_t end) {
+    int ret = 0;
+    extent_iter_t it;
+    extent_t ext;
+    extent_iter_init(&it, inode, first, end);
+    while (extent_iter_next(&it, &ext)) {
+        if (ext.flags & EXTENT_HOLE) continue;
+        for (uint32_t k = 0; k < ext.length; ++k) {
+            if (cache_sync(ext.physical + k) != 0) ret = -1;
+        }
+    }
+    extent_iter_done(&it);
+    for (int i = 0; i < INDIRECT_POINTERS; ++i) {
+        if (inode->indirect_block_pointer[i] != 0 && cache_sync(inode->indirect_block_pointer[i]) != 0) ret = -1;
+    }
+    if (cache_sync(inode_table_block(inode_num / INODES_PER_BLOCK)) != 0) ret = -1;
+    return ret;
+}
+
+// 预读文件从逻辑块 first 开始的 READAHEAD_BLOCKS 个块
+void readahead_file(const inode_t *inode, uint32_t first) {
+    uint32_t end = min((uint32_t)ceil_div(inode->size, BLOCK_SIZE), first + READAHEAD_BLOCKS);
+    int blocks[READAHEAD_BLOCKS];
+    int n = 0;
+    extent_iter_t it;
+    extent_t ext;
+    extent_iter_init(&it, inode, first, end);
+    while (extent_iter_next(&it, &ext)) {
+        if (ext.flags & EXTENT_HOLE) continue;
+        for (uint32_t k = 0; k < ext.length; ++k) {
+            blocks[n++] = ext.physical + k;
+        }
+    }
+    extent_iter_done(&it);
+    cache_prefetch(blocks, n);
+}
+
+static const struct {
+    const char *name;
+    uint32_t flag;
+} policy_names[] = {
+    {"nocache", FSLAB_POLICY_NOCACHE},
+    {"writeback", FSLAB_POLICY_WRITEBACK},
+    {"writethrough", FSLAB_POLICY_WRITETHROUGH},
+    {"sync-on-close", FSLAB_POLICY_SYNC_ON_CLOSE},
+    {"sequential", FSLAB_POLICY_SEQUENTIAL},
+};
+#define POLICY_NAME_COUNT (sizeof(policy_names) / sizeof(policy_names[0]))
+
+// 解析逗号分隔的策略名（text 不一定以 \0 结尾），有未知的名字时返回 -1
+int policy_parse(const char *text, size_t len, uint32_t *policy) {
+    *policy = 0;
+    size_t start = 0;
+    while (start < len) {
+        size_t end = start;
+        while (end < len && text[end] != ',') end++;
+        size_t n = end - start;
+        if (n > 0) {
+            size_t i;
+            for (i = 0; i < POLICY_NAME_COUNT; ++i) {
+                if (strlen(policy_names[i].name) == n && strncmp(policy_names[i].name, text + start, n) == 0) break;
+            }
+            if (i == POLICY_NAME_COUNT) return -1;
+            *policy |= policy_names[i].flag;
+        }
+        start = end + 1;
+    }
+    return 0;
+}
+
+// 把策略格式化为逗号分隔的策略名，返回长度（不含 \0）
+int policy_format(uint32_t policy, char *buf, size_t size) {
+    int len = 0;
+    buf[0] = '\0';
+    for (size_t i = 0; i < POLICY_NAME_COUNT; ++i) {
+        if (policy & policy_names[i].flag) {
+            len += snprintf(buf + len, size - len, "%s%s", len ? "," : "", policy_names[i].name);
+        }
+    }
+    return len;
+}
+
+// 修改 inode 的策略，writeback 和 writethrough 不能同时设置
+int set_policy(uint32_t inode_num, inode_t *inode, uint32_t policy) {
+    if ((policy & ~FSLAB_POLICY_ALL) ||
+        ((policy & FSLAB_POLICY_WRITEBACK) && (policy & (FSLAB_POLICY_WRITETHROUGH | FSLAB_POLICY_NOCACHE)))) {
+        return -EINVAL;
+    }
+    // 改为 nocache 时，之前留在缓存里的尾块不能再被追加写使用
+    if (policy & FSLAB_POLICY_NOCACHE) {
+        tail_forget(inode_num);
+    }
+    inode->policy = policy;
+    update_timestamp(inode, false, false, true);
+    return write_inode(inode_num, inode) != 0 ? -EIO : 0;
+}
+
+// 变更块跟踪：检查点之后每个被写入或截断涉及的文件块在位图块中置一位，
+// 文件最多 CBT_BITS 块，一个位图块就够了
+#define CBT_BITS (MAX_FILE_SIZE / BLOCK_SIZE)
+
+void cbt_mark(const inode_t *inode, uint32_t first, uint32_t end) {
+    end = min(end, (uint32_t)CBT_BITS);
+    if (inode->cbt_block == 0 || first >= end) return;
+    buf_t *bh = cache_get_meta(inode->cbt_block);
+    if (bh == NULL) return;
+    unsigned char *bits = (unsigned char *)bh->data;
+    for (uint32_t i = first; i < end; ++i) {
+        bits[i / 8] |= 1 << (i % 8);
+    }
+    cache_mark_dirty(bh);
+    cache_put(bh);
+}
+
+// 设置检查点：第一次时分配位图块，之后清空位图
+int cbt_checkpoint(uint32_t inode_num, inode_t *inode) {
+    if (inode->cbt_block != 0) {
+        buf_t *bh = cache_get_meta(inode->cbt_block);
+        if (bh == NULL) return -EIO;
+        memset(bh->data, 0, ceil_div(CBT_BITS, 8));
+        cache_mark_dirty(bh);
+        cache_put(bh);
+        return 0;
+    }
+    int block = alloc_data_block();
+    if (block < 0) return block;
+    buf_t *bh = cache_get_zeroed(block);
+    if (bh == NULL) {
+        free_data_block(block);
+        return -EIO;
+    }
+    cache_mark_meta(bh);
+    cache_put(bh);
+    inode->cbt_block = block;
+    return write_inode(inode_num, inode) != 0 ? -EIO : 0;
+}
+
+// 把位图中 [start, start + length) 范围内连续置位的块合并成区间返回
+int cbt_ranges(const inode_t *inode, struct fslab_range_query *q) {
+    q->count = 0;
+    q->flags = 0;
+    if (inode->cbt_block == 0) {
+        q->flags |= FSLAB_RANGES_UNTRACKED;
+        return 0;
+    }
+    uint64_t end = query_end(q->start, q->length, inode->size);
+    if (q->start >= end) return 0;
+    buf_t *bh = cache_get_meta(inode->cbt_block);
+    if (bh == NULL) return -EIO;
+    const unsigned char *bits = (const unsigned char *)bh->data;
+    uint32_t last = min(ceil_div(end, BLOCK_SIZE), (uint64_t)CBT_BITS);
+    for (uint32_t i = q->start / BLOCK_SIZE; i < last;) {
+        if (!((bits[i / 8] >> (i % 8)) & 1)) {
+            i++;
+            continue;
+        }
+        if (q->count == FSLAB_RANGE_MAX) {
+            q->flags |= FSLAB_RANGES_MORE;
+            break;
+        }
+        uint32_t run = i;
+        while (run < last && ((bits[run / 8] >> (run % 8)) & 1)) run++;
+        struct fslab_range *r = &q->ranges[q->count++];
+        r->offset = (uint64_t)i * BLOCK_SIZE;
+        r->length = min((uint64_t)run * BLOCK_SIZE, end) - r->offset;
+        i = run;
+    }
+    cache_put(bh);
+    return 0;
+}
+
+// 绕过块缓存直接读写一个数据块，同时计入热度图
+int read_uncached(int block, char *buf) {
+    heat_read(block);
+    return disk_read(block, buf);
+}
+
+int write_uncached(int block, const char *buf) {
+    heat_write(block);
+    return disk_write(block, (void *)buf);
+}
+
+// 检查是否存在以 prefix 开头的选项（如 `--direct-io`、`--latency-budget=`），用法和 has_noinit_flag 相同：
+// 存在时从参数列表中删除并返回 1，*value 指向 prefix 之后的部分
+int take_flag(int *argc_ptr, char *argv[], const char *prefix, const char **value) {
+    size_t len = strlen(prefix);
+    for (int i = 1; i < *argc_ptr; i++) {
+        if (strncmp(argv[i], prefix, len) == 0) {
+            if (value != NULL) *value = argv[i] + len;
+            for (int j = i; j < *argc_ptr - 1; j++) {
+                argv[j] = argv[j + 1];
+            }
+            (*argc_ptr)--;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void request_begin(void) {
+    if (latency_budget == 0) return;
+    cache_request_begin();
+    pending_free_run(pending_blocks > PENDING_HIGH_WATER ? 4 * latency_budget : latency_budget);
+}
+
+// 把一个已经摘下的间接块组（count 个数据块）交给后台释放，队列满时返回 false
+bool pending_free_push(uint32_t indirect, int64_t count) {
+    if (latency_budget == 0 || pending_n == PENDING_GROUPS) return false;
+    pending_frees[pending_n++] = (pending_free_t){.indirect = indirect, .next = 0};
+    pending_blocks += count;
+    return true;
+}
+
+// 释放至多 units 个推迟的块，units 为负数时全部释放
+void pending_free_run(int units) {
+    while (units != 0 && pending_n > 0) {
+        pending_free_t *p = &pending_frees[pending_n - 1];
+        buf_t *bh = cache_get(p->indirect);
+        if (bh == NULL) {
+            // 读不出间接块时这一组留在队列里，换到队首，先释放其他组，之后的请求再试
+            fs_warning("pending_free_run: read indirect block %u failed, retrying later\n", p->indirect);
+            pending_free_t t = *p;
+            *p = pending_frees[0];
+            pending_frees[0] = t;
+            return;
+        }
+        // 间接块已经不属于任何文件，内容不会再变，这里只读
+        uint32_t *pointers = (uint32_t *)bh->data;
+        for (; units != 0 && p->next < POINTERS_PER_BLOCK; p->next++) {
+            if (pointers[p->next] == 0) continue;
+            free_data_block(pointers[p->next]);
+            pending_blocks--;
+            background_freed++;
+            units--;
+        }
+        cache_put(bh);
+        if (p->next < POINTERS_PER_BLOCK) return;
+        free_data_block(p->indirect);
+        pending_n--;
+    }
+}
+
+// ioctl 查询 [start, start + length) 在文件内的终点，length 可以是 ~0（即查到文件末尾），加法不能溢出
+uint64_t query_end(uint64_t start, uint64_t length, uint64_t size) {
+    return length > size - min(start, size) ? size : start + length;
+}
+
+void extent_iter_init(extent_iter_t *it, const inode_t *inode, uint32_t first, uint32_t end) {
+    it->inode = inode;
+    it->next = first;
+    it->end = min(end, (uint32_t)(DIRECT_POINTERS + INDIRECT_POINTERS * POINTERS_PER_BLOCK));
+    it->group = -1;
+    it->indirect = NULL;
+}
+
+// 返回逻辑块 file_block_idx 对应的物理块号，空洞返回 0
+// 只有在切换到另一个间接块时才需要访问缓存
+uint32_t extent_iter_lookup(extent_iter_t *it, uint32_t file_block_idx) {
+    if (file_block_idx < DIRECT_POINTERS) {
+        return it->inode->direct_block_pointer[file_block_idx];
+    }
+    file_block_idx -= DIRECT_POINTERS;
+    int group = file_block_idx / POINTERS_PER_BLOCK;
+    if (group >= INDIRECT_POINTERS) return 0;
+    if (group != it->group) {
+        if (it->indirect != NULL) {
+            cache_put(it->indirect);
+            it->indirect = NULL;
+            it->group = -1;
+        }
+        // 间接块不存在时不缓存，调用者可能会在遍历过程中分配它
+        uint32_t addr = it->inode->indirect_block_pointer[group];
+        if (addr == 0 || (it->indirect = cache_get(addr)) == NULL) return 0;
+        it->group = group;
+    }
+    return ((uint32_t *)it->indirect->data)[file_block_idx % POINTERS_PER_BLOCK];
+}
+
+// 取出下一段区间，遍历结束返回 false
+bool extent_iter_next(extent_iter_t *it, extent_t *ext) {
+    if (it->next >= it->end) return false;
+    uint32_t first = extent_iter_lookup(it, it->next);
+    ext->logical = it->next;
+    ext->physical = first;
+    ext->length = 1;
+    ext->flags = first == 0 ? EXTENT_HOLE : 0;
+    it->next++;
+    while (it->next < it->end) {
+        uint32_t b = extent_iter_lookup(it, it->next);
+        if (first == 0 ? b != 0 : b != first + ext->length) break;
+        ext->length++;
+        it->next++;
+    }
+    if (it->next >= it->end) ext->flags |= EXTENT_LAST;
+    return true;
+}
+
+void extent_iter_done(extent_iter_t *it) {
+    if (it->indirect != NULL) cache_put(it->indirect);
+    it->indirect = NULL;
+    it->group = -1;
+}
+
+static tail_block_t tails[TAIL_SLOTS];
+static uint64_t tail_clock;
+
+// 返回 inode_num 第 file_block_idx 块对应的尾块缓存，未命中返回 NULL
+// 返回的句柄由尾块表持有，调用者不需要 cache_put
+buf_t *tail_lookup(uint32_t inode_num, int file_block_idx) {
+    for (int i = 0; i < TAIL_SLOTS; ++i) {
+        if (tails[i].inode_num == inode_num && inode_num != 0 &&
+            tails[i].file_block_idx == file_block_idx) {
+            tails[i].last_use = ++tail_clock;
+            return tails[i].bh;
+        }
+    }
+    return NULL;
+}
+
+// 记录 inode_num 的尾块，表满时替换最久未用的一项
+void tail_remember(uint32_t inode_num, int file_block_idx, buf_t *bh) {
+    tail_block_t *slot = &tails[0];
+    for (int i = 0; i < TAIL_SLOTS; ++i) {
+        if (tails[i].inode_num == inode_num) {
+            slot = &tails[i];
+            break;
+        }
+        if (tails[i].last_use < slot->last_use) slot = &tails[i];
+    }
+    if (slot->inode_num == inode_num && slot->bh == bh) {
+        slot->file_block_idx = file_block_idx;
+        slot->last_use = ++tail_clock;
+        return;
+    }
+    buf_t *pinned = cache_get(bh->block);
+    if (pinned == NULL) return;
+    if (slot->bh != NULL) cache_put(slot->bh);
+    slot->inode_num = inode_num;
+    slot->file_block_idx = file_block_idx;
+    slot->bh = pinned;
+    slot->last_use = ++tail_clock;
+}
+
+void tail_forget(uint32_t inode_num) {
+    for (int i = 0; i < TAIL_SLOTS; ++i) {
+        if (tails[i].inode_num == inode_num && tails[i].bh != NULL) {
+            cache_put(tails[i].bh);
+            memset(&tails[i], 0, sizeof(tail_block_t));
+        }
+    }
+}
+
+void tail_forget_all(void) {
+    for (int i = 0; i < TAIL_SLOTS; ++i) {
+        if (tails[i].bh != NULL) cache_put(tails[i].bh);
+        memset(&tails[i], 0, sizeof(tail_block_t));
+    }
+}
 
 // 释放一个 inode 所有的 data blocks
 void free_all_data_blocks(inode_t *inode) {
-    // ... 必须遍历所有直接、一级间接指针，并调用 free_data_block
+    free_blocks_from(inode, 0);
+    if (inode->cbt_block != 0) {
+        free_data_block(inode->cbt_block);
+        inode->cbt_block = 0;
+    }
+    inode->size = 0;
+    inode->blocks = 0;
+}
+
+// 释放文件第 first 块及之后的所有数据块，不再被使用的间接块也一并释放
+void free_blocks_from(inode_t *inode, int first) {
+    for (int i = first; i < DIRECT_POINTERS; ++i) {
+        if (inode->direct_block_pointer[i] != 0) {
+            free_data_block(inode->direct_block_pointer[i]);
+            inode->direct_block_pointer[i] = 0;
+            inode->blocks--;
+        }
+    }
+    for (int i = 0; i < INDIRECT_POINTERS; ++i) {
+        if (inode->indirect_block_pointer[i] == 0) continue;
+        int start = first - DIRECT_POINTERS - i * (int)POINTERS_PER_BLOCK;
+        if (start < 0) start = 0;
+        if (start >= POINTERS_PER_BLOCK) continue;
+        buf_t *bh = cache_get(inode->indirect_block_pointer[i]);
+        if (bh != NULL && start == 0 && latency_budget > 0) {
+            // 受限延迟模式下整组摘下交给后台释放，这里只更新计数
+            int64_t count = 0;
+            for (int j = 0; j < POINTERS_PER_BLOCK; ++j) {
+                if (((uint32_t *)bh->data)[j] != 0) count++;
+            }
+            cache_put(bh);
+            if (pending_free_push(inode->indirect_block_pointer[i], count)) {
+                inode->indirect_block_pointer[i] = 0;
+                inode->blocks -= count + 1;
+                continue;
+            }
+            bh = cache_get(inode->indirect_block_pointer[i]);
+        }
+        if (bh != NULL) {
+            uint32_t *pointers = (uint32_t *)bh->data;
+            for (int j = start; j < POINTERS_PER_BLOCK; ++j) {
+                if (pointers[j] != 0) {
+                    free_data_block(pointers[j]);
+                    pointers[j] = 0;
+                    inode->blocks--;
+                }
+            }
+            cache_mark_dirty(bh);
+            cache_put(bh);
+        }
+        if (start == 0) {
+            free_data_block(inode->indirect_block_pointer[i]);
+            inode->indirect_block_pointer[i] = 0;
+            inode->blocks--;
+        }
+    }
 }
 
 // 更新时间戳
@@ -656,6 +2418,8 @@ void update_timestamp(inode_t *inode, bool access, bool modify, bool change) {
     if (change) inode->ctime = (uint32_t)ts.tv_sec; 
 }
 
+// 微基准测试（tests/microbench）直接包含本文件，只需要内部函数
+#ifndef FSLAB_MICROBENCH
 static struct fuse_operations fs_operations = {.getattr = fs_getattr,
                                                .readdir = fs_readdir,
                                                .read = fs_read,
@@ -669,9 +2433,13 @@ static struct fuse_operations fs_operations = {.getattr = fs_getattr,
                                                .write = fs_write,
                                                .statfs = fs_statfs,
                                                .open = fs_open,
+                                               .flush = fs_flush,
                                                .release = fs_release,
                                                .opendir = fs_opendir,
-                                               .releasedir = fs_releasedir};
+                                               .releasedir = fs_releasedir,
+                                               .setxattr = fs_setxattr,
+                                               .getxattr = fs_getxattr,
+                                               .ioctl = fs_ioctl};
 
 int main(int argc, char* argv[]) {
     // 理论上，你不需要也不应该修改 main 函数内的代码，只需要实现对应的函数
@@ -679,6 +2447,18 @@ int main(int argc, char* argv[]) {
     int init_flag = !has_noinit_flag(&argc, argv);
     // 通过 make mount 或者 make debug 启动时，该值为 1
     // 通过 make mount_noinit 或者 make debug_noinit 启动时，该值为 0
+    mount_direct_io = take_flag(&argc, argv, "--direct-io", NULL);
+    // 通过 make mount FUSE_OPTS="-o big_writes --direct-io" 启动时，该值为 1
+    format_dynamic_inodes = take_flag(&argc, argv, "--dynamic-inodes", NULL);
+    // 通过 make mount FUSE_OPTS="-o big_writes --dynamic-inodes" 格式化时，inode 表按需从数据区分配
+    format_change_log = take_flag(&argc, argv, "--change-log", NULL);
+    // 通过 make mount FUSE_OPTS="-o big_writes --change-log" 格式化时，预留变更日志，见 changelog.h
+    const char *budget;
+    if (take_flag(&argc, argv, "--latency-budget=", &budget)) {
+        latency_budget = atoi(budget);
+        cache_set_budget(latency_budget);
+    }
+    // 通过 make mount FUSE_OPTS="-o big_writes --latency-budget=16" 启动时，每个请求最多做 16 个单位的可推迟工作
 
     if (disk_mount(init_flag)) {  // 不需要修改
         fs_error("disk_mount failed!\n");
@@ -698,3 +2478,4 @@ int main(int argc, char* argv[]) {
     // fs_finalize 函数中完成
     return fs_finalize(fuse_status);
 }
+#endif
@@ -0,0 +1,163 @@
+#ifndef FSLAB_IOCTL_H
+#define FSLAB_IOCTL_H
+
+// fslab 对外提供的 ioctl 接口，工具程序直接包含这个头文件
+
+#include <stdint.h>
+#include <sys/ioctl.h>
+
+#define FSLAB_IOC_MAGIC 'f'
+
+// ---- FSLAB_IOC_EXTENTS：查询文件数据块的分布（类似 FIEMAP） ----
+
+#define FSLAB_EXTENT_MAX 128
+
+#define FSLAB_EXTENT_HOLE 0x1   // 该区间是空洞，physical 无意义
+#define FSLAB_EXTENT_LAST 0x2   // 查询范围内的最后一个区间
+
+struct fslab_extent {
+    uint64_t logical;    // 文件内偏移（字节）
+    uint64_t physical;   // 磁盘上的偏移（字节）
+    uint64_t length;     // 长度（字节）
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+struct fslab_extent_query {
+    uint64_t start;      // 输入：查询起点（字节，向下对齐到块）
+    uint64_t length;     // 输入：查询长度（字节），超过文件末尾的部分被忽略
+    uint32_t count;      // 输出：extents 中有效的条目数
+    uint32_t reserved;
+    struct fslab_extent extents[FSLAB_EXTENT_MAX];
+};
+
+#define FSLAB_IOC_EXTENTS _IOWR(FSLAB_IOC_MAGIC, 1, struct fslab_extent_query)
+
+// ---- FSLAB_IOC_GET_POLICY / FSLAB_IOC_SET_POLICY：文件的缓存和持久化策略 ----
+//
+// 也可以通过扩展属性 user.fslab.policy 读写，值为逗号分隔的策略名，例如 "nocache,sync-on-close"。
+// 目录上的策略会被其中新建的文件和目录继承
+
+#define FSLAB_POLICY_NOCACHE       0x01 // 读写都不经过缓存（页缓存和块缓存）
+#define FSLAB_POLICY_WRITEBACK     0x02 // 总是经过缓存，即使挂载时启用了 --direct-io；只决定是否经过缓存，
+                                        // 脏块和其他文件一样由缓存换出和后台写回，不会额外推迟
+#define FSLAB_POLICY_WRITETHROUGH  0x04 // 每次写返回前把写入的块和 inode 写回磁盘
+#define FSLAB_POLICY_SYNC_ON_CLOSE 0x08 // close() 时把文件所有的脏块写回磁盘，失败时 close() 返回 EIO
+#define FSLAB_POLICY_SEQUENTIAL    0x10 // 顺序访问，读时预读后续的块
+#define FSLAB_POLICY_ALL           0x1f
+
+#define FSLAB_IOC_GET_POLICY _IOR(FSLAB_IOC_MAGIC, 2, uint32_t)
+#define FSLAB_IOC_SET_POLICY _IOW(FSLAB_IOC_MAGIC, 3, uint32_t)
+
+// ---- FSLAB_IOC_SCAN_INODES：按 inode 表顺序批量读取已分配的 inode ----
+//
+// 给备份和索引工具用，不需要逐个解析路径。在文件系统内任意路径上调用（通常是挂载点），
+// 第一次调用时 next 置 0，之后原样传回，直到 flags 中出现 FSLAB_SCAN_END。
+// 扫描期间新建或删除的 inode 可能被看到也可能看不到
+
+#define FSLAB_SCAN_MAX 256
+
+#define FSLAB_SCAN_END 0x1      // 已经扫描到 inode 表末尾
+
+struct fslab_inode_rec {
+    uint32_t ino;
+    uint32_t mode;
+    uint32_t parent;     // 父目录的 inode 编号，根目录指向自己
+    uint32_t size;       // 字节
+    uint32_t atime;
+    uint32_t mtime;
+    uint32_t ctime;
+    uint32_t blocks;     // 已分配的数据块数（包括间接块）
+};
+
+struct fslab_inode_scan {
+    uint32_t next;       // 输入：从这个 inode 编号开始扫描；输出：下一次调用的起点
+    uint32_t count;      // 输出：inodes 中有效的条目数
+    uint32_t flags;      // 输出
+    uint32_t reserved;
+    struct fslab_inode_rec inodes[FSLAB_SCAN_MAX];
+};
+
+#define FSLAB_IOC_SCAN_INODES _IOWR(FSLAB_IOC_MAGIC, 4, struct fslab_inode_scan)
+
+// ---- FSLAB_IOC_READ_CHANGES：读取变更日志 ----
+//
+// 只在格式化时带 --change-log 的文件系统上可用，否则返回 EOPNOTSUPP。在任意路径上调用，
+// 第一次调用时 cursor 置 0，之后原样传回，每次返回 cursor 之后的至多 FSLAB_CHANGE_MAX 条记录。
+// 日志是有界的环形缓冲区：如果 cursor 之后的记录已经被覆盖，设置 FSLAB_CHANGES_LOST，
+// 从最旧的记录开始返回，调用者需要做一次完整的遍历（可以用 FSLAB_IOC_SCAN_INODES）。
+// 同一个文件连续的写入只有一条 FSLAB_CHANGE_WRITE 记录
+
+#define FSLAB_CHANGE_MAX 256
+
+#define FSLAB_CHANGE_CREATE      1  // 新建文件或目录，parent 为所在目录
+#define FSLAB_CHANGE_REMOVE      2  // 删除（包括被改名覆盖的目标）
+#define FSLAB_CHANGE_RENAME_FROM 3  // 改名，parent 为原来的目录，紧接着一条 RENAME_TO
+#define FSLAB_CHANGE_RENAME_TO   4  // parent 为新的目录
+#define FSLAB_CHANGE_WRITE       5
+#define FSLAB_CHANGE_TRUNCATE    6
+
+#define FSLAB_CHANGES_LOST 0x1  // cursor 之后有记录已经被覆盖
+
+struct fslab_change {
+    uint64_t seq;        // 从 1 开始连续递增
+    uint32_t ino;
+    uint32_t parent;
+    uint32_t op;         // FSLAB_CHANGE_*
+    uint32_t time;       // 记录时的时间（秒）
+};
+
+struct fslab_change_query {
+    uint64_t cursor;     // 输入：已经处理过的最后一个序号；输出：返回的最后一条记录的序号
+    uint64_t head;       // 输出：当前最新记录的序号
+    uint32_t count;      // 输出：changes 中有效的条目数
+    uint32_t flags;      // 输出
+    struct fslab_change changes[FSLAB_CHANGE_MAX];
+};
+
+#define FSLAB_IOC_READ_CHANGES _IOWR(FSLAB_IOC_MAGIC, 5, struct fslab_change_query)
+
+// ---- FSLAB_IOC_INODE_PATH：由 inode 编号反查当前路径 ----
+//
+// 用于把 FSLAB_IOC_READ_CHANGES 和 FSLAB_IOC_SCAN_INODES 返回的 inode 编号换成路径，
+// 在任意路径上调用。inode 已经被删除时返回 ENOENT，路径超过 FSLAB_PATH_MAX 时返回 ERANGE
+
+#define FSLAB_PATH_MAX 4096
+
+struct fslab_inode_path {
+    uint32_t ino;        // 输入
+    uint32_t reserved;
+    char path[FSLAB_PATH_MAX];   // 输出：以 / 开头、以 \0 结尾的绝对路径
+};
+
+#define FSLAB_IOC_INODE_PATH _IOWR(FSLAB_IOC_MAGIC, 8, struct fslab_inode_path)
+
+// ---- FSLAB_IOC_CHECKPOINT / FSLAB_IOC_CHANGED_RANGES：文件的变更块跟踪 ----
+//
+// 对文件设置检查点后，之后写入和截断涉及的块都会被记录（按块粒度，可能偏多但不会遗漏），
+// FSLAB_IOC_CHANGED_RANGES 返回自检查点以来修改过的区间，增量备份只需要读这些区间。
+// 再次设置检查点会清空记录。没有设置过检查点的文件返回 FSLAB_RANGES_UNTRACKED，
+// 调用者应该读整个文件
+
+#define FSLAB_RANGE_MAX 256
+
+#define FSLAB_RANGES_UNTRACKED 0x1  // 文件没有检查点，ranges 为空
+#define FSLAB_RANGES_MORE      0x2  // ranges 已满，从最后一个区间的末尾继续查询
+
+struct fslab_range {
+    uint64_t offset;     // 文件内偏移（字节）
+    uint64_t length;     // 长度（字节）
+};
+
+struct fslab_range_query {
+    uint64_t start;      // 输入：查询起点（字节，向下对齐到块）
+    uint64_t length;     // 输入：查询长度（字节），超过文件末尾的部分被忽略
+    uint32_t count;      // 输出：ranges 中有效的条目数
+    uint32_t flags;      // 输出
+    struct fslab_range ranges[FSLAB_RANGE_MAX];
+};
+
+#define FSLAB_IOC_CHECKPOINT     _IO(FSLAB_IOC_MAGIC, 6)
+#define FSLAB_IOC_CHANGED_RANGES _IOWR(FSLAB_IOC_MAGIC, 7, struct fslab_range_query)
+
+#endif
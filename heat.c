@@ -0,0 +1,94 @@
+#include "heat.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static uint32_t reads[HEAT_BUCKETS];
+static uint32_t writes[HEAT_BUCKETS];
+
+static struct {
+    const char *name;
+    int first, end;
+    uint64_t reads, writes;
+} parts[HEAT_MAX_PARTS];
+static int nr_parts;
+
+void heat_clear_parts(void) {
+    nr_parts = 0;
+}
+
+void heat_add_part(const char *name, int first, int end) {
+    if (nr_parts == HEAT_MAX_PARTS || first >= end) return;
+    parts[nr_parts].name = name;
+    parts[nr_parts].first = first;
+    parts[nr_parts].end = end;
+    parts[nr_parts].reads = parts[nr_parts].writes = 0;
+    nr_parts++;
+}
+
+// 分区很少，线性查找即可，相比一次磁盘读写可以忽略
+static int part_of(int block) {
+    for (int i = 0; i < nr_parts; ++i) {
+        if (block >= parts[i].first && block < parts[i].end) return i;
+    }
+    return -1;
+}
+
+void heat_read(int block) {
+    if (block < 0 || block >= BLOCK_NUM) return;
+    __atomic_fetch_add(&reads[block / HEAT_BUCKET_BLOCKS], 1, __ATOMIC_RELAXED);
+    int p = part_of(block);
+    if (p >= 0) __atomic_fetch_add(&parts[p].reads, 1, __ATOMIC_RELAXED);
+}
+
+void heat_write(int block) {
+    if (block < 0 || block >= BLOCK_NUM) return;
+    __atomic_fetch_add(&writes[block / HEAT_BUCKET_BLOCKS], 1, __ATOMIC_RELAXED);
+    int p = part_of(block);
+    if (p >= 0) __atomic_fetch_add(&parts[p].writes, 1, __ATOMIC_RELAXED);
+}
+
+int heat_format(char *buf, size_t size) {
+    size_t len = 0;
+    // 空间不够时继续计算长度，但不再写入
+#define EMIT(...)                                                                   \
+    do {                                                                            \
+        int n = snprintf(len < size ? buf + len : NULL, len < size ? size - len : 0, \
+                         __VA_ARGS__);                                              \
+        if (n > 0) len += n;                                                        \
+    } while (0)
+    EMIT("heatmap %d %d\n", HEAT_BUCKET_BLOCKS, BLOCK_NUM);
+    for (int i = 0; i < nr_parts; ++i) {
+        char name[32];
+        snprintf(name, sizeof(name), "%s", parts[i].name);
+        for (char *c = name; *c; ++c) {
+            if (*c == ' ') *c = '_';
+        }
+        EMIT("part %s %d %d %llu %llu\n", name, parts[i].first, parts[i].end,
+             (unsigned long long)__atomic_load_n(&parts[i].reads, __ATOMIC_RELAXED),
+             (unsigned long long)__atomic_load_n(&parts[i].writes, __ATOMIC_RELAXED));
+    }
+    for (int i = 0; i < HEAT_BUCKETS; ++i) {
+        uint32_t r = __atomic_load_n(&reads[i], __ATOMIC_RELAXED);
+        uint32_t w = __atomic_load_n(&writes[i], __ATOMIC_RELAXED);
+        if (r || w) EMIT("%d %u %u\n", i, r, w);
+    }
+#undef EMIT
+    return (int)len;
+}
+
+int heat_dump(const char *path) {
+    int len = heat_format(NULL, 0);
+    char *text = malloc(len + 1);
+    if (text == NULL) return -1;
+    heat_format(text, len + 1);
+    FILE *f = fopen(path, "w");
+    int ret = -1;
+    if (f != NULL) {
+        ret = fwrite(text, 1, len, f) == (size_t)len ? 0 : -1;
+        if (fclose(f) != 0) ret = -1;
+    }
+    free(text);
+    return ret;
+}
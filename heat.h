@@ -0,0 +1,37 @@
+#ifndef HEAT_H
+#define HEAT_H
+
+#include <stddef.h>
+
+#include "disk.h"
+
+// 块访问热度图
+//
+// 设备按 HEAT_BUCKET_BLOCKS 个块划分为若干区域，每个区域记录实际发生的磁盘读写次数
+// （缓存命中不计）。可以通过根目录上的扩展属性 user.fslab.heatmap 随时读取，
+// 或者设置环境变量 FSLAB_HEATMAP 为一个绝对路径，卸载时写到该文件中。
+// 用 tests/bench/heatmap.py 渲染
+#define HEAT_BUCKET_BLOCKS 64
+#define HEAT_BUCKETS (BLOCK_NUM / HEAT_BUCKET_BLOCKS)
+
+// 磁盘布局中的分区（超级块、位图、inode 表等），按块号精确统计每个分区的读写次数，
+// 不受区域划分的影响。挂载时先 heat_clear_parts，再按块号顺序逐个 heat_add_part
+#define HEAT_MAX_PARTS 8
+void heat_clear_parts(void);
+void heat_add_part(const char *name, int first, int end);
+
+// 记录一次磁盘读 / 写，可以在写线程中调用
+void heat_read(int block);
+void heat_write(int block);
+
+// 把热度图格式化为文本，返回完整输出需要的长度（不含 \0），和 snprintf 相同
+//
+// 第一行为 "heatmap <每个区域的块数> <总块数>"，之后每个分区一行
+// "part <名字> <起始块> <结束块（不含）> <读次数> <写次数>"（名字中的空格换成 _），
+// 最后每行为 "<区域编号> <读次数> <写次数>"，只输出有访问的区域
+int heat_format(char *buf, size_t size);
+
+// 把热度图写到 path，成功返回 0
+int heat_dump(const char *path);
+
+#endif
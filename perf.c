@@ -0,0 +1,179 @@
+#include "config.h"
+#include "perf.h"
+
+#ifdef FSLAB_PERF
+
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "logger.h"
+
+#define PERF_EVENTS 4
+#define CTXSW_EVENT 3
+
+static const struct {
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+} events[PERF_EVENTS] = {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {"ctx-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+};
+
+static const char *op_names[PERF_OP_COUNT] = {
+    "getattr", "readdir",    "read",     "mknod",    "mkdir",   "unlink", "rmdir",
+    "rename",  "write",      "truncate", "utimens",  "statfs",  "open",   "flush",
+    "release", "opendir",    "releasedir", "getxattr", "setxattr", "ioctl",
+};
+
+static bool opened;
+static int leader = -1;
+// slot[i] 是 events[i] 在分组读出结果中的位置，-1 表示打不开
+static int slot[PERF_EVENTS];
+static int fds[PERF_EVENTS];
+static int nr_open;
+// 不允许统计内核态时只统计用户态，此时上下文切换改从 getrusage 读取
+static bool exclude_kernel;
+static bool ctxsw_rusage;
+static int depth;
+static uint64_t start[PERF_EVENTS];
+
+static struct {
+    uint64_t calls;
+    uint64_t sum[PERF_EVENTS];
+} stats[PERF_OP_COUNT];
+
+static int open_event(int i, int group_fd) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = events[i].type;
+    attr.config = events[i].config;
+    attr.exclude_kernel = exclude_kernel;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.disabled = group_fd == -1;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+static void close_events(void) {
+    for (int i = 0; i < PERF_EVENTS; ++i) {
+        if (slot[i] >= 0) close(fds[i]);
+        slot[i] = -1;
+    }
+    leader = -1;
+    nr_open = 0;
+}
+
+// 先连同内核态一起统计，回调的时间很多花在 disk_read/disk_write 的系统调用里；
+// perf_event_paranoid 不允许时（EACCES/EPERM）整组改为只统计用户态重新打开
+static void open_events(void) {
+    opened = true;
+    for (int i = 0; i < PERF_EVENTS; ++i) slot[i] = -1;
+    for (int i = 0; i < PERF_EVENTS; ++i) {
+        // 只统计用户态时软件事件 context-switches 恒为 0
+        if (exclude_kernel && i == CTXSW_EVENT) {
+            ctxsw_rusage = true;
+            continue;
+        }
+        int fd = open_event(i, leader);
+        if (fd < 0 && !exclude_kernel && (errno == EACCES || errno == EPERM)) {
+            fs_warning("perf: kernel events not permitted, counting user space only\n");
+            close_events();
+            exclude_kernel = true;
+            i = -1;
+            continue;
+        }
+        if (fd < 0) {
+            fs_warning("perf: %s unavailable\n", events[i].name);
+            continue;
+        }
+        if (leader == -1) leader = fd;
+        fds[i] = fd;
+        slot[i] = nr_open++;
+    }
+    if (leader != -1) {
+        ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+}
+
+static bool available(int i) {
+    return slot[i] >= 0 || (i == CTXSW_EVENT && ctxsw_rusage);
+}
+
+// 一次 read 读出整组计数器
+static bool read_events(uint64_t *values) {
+    uint64_t buf[1 + PERF_EVENTS];
+    if (leader != -1 && read(leader, buf, sizeof(buf)) < (ssize_t)((1 + nr_open) * sizeof(uint64_t))) {
+        return false;
+    }
+    for (int i = 0; i < PERF_EVENTS; ++i) {
+        values[i] = slot[i] >= 0 ? buf[1 + slot[i]] : 0;
+    }
+    if (ctxsw_rusage) {
+        struct rusage ru;
+        if (getrusage(RUSAGE_THREAD, &ru) != 0) return false;
+        values[CTXSW_EVENT] = (uint64_t)(ru.ru_nvcsw + ru.ru_nivcsw);
+    }
+    return true;
+}
+
+perf_scope_t perf_scope_begin(perf_op_t op) {
+    perf_scope_t scope = {-1};
+    if (!opened) open_events();
+    if ((leader == -1 && !ctxsw_rusage) || depth++ > 0) return scope;
+    if (read_events(start)) scope.op = op;
+    return scope;
+}
+
+void perf_scope_end(perf_scope_t *scope) {
+    if (leader == -1 && !ctxsw_rusage) return;
+    depth--;
+    uint64_t end[PERF_EVENTS];
+    if (scope->op < 0 || !read_events(end)) return;
+    stats[scope->op].calls++;
+    for (int i = 0; i < PERF_EVENTS; ++i) {
+        stats[scope->op].sum[i] += end[i] - start[i];
+    }
+}
+
+void perf_report(void) {
+    if (leader == -1 && !ctxsw_rusage) {
+        fs_important("perf: counters unavailable\n");
+        return;
+    }
+    if (exclude_kernel) fs_important("perf: user space only, ctxsw from getrusage\n");
+    fs_important("perf: %-10s %8s %12s %12s %6s %12s %12s\n", "op", "calls", "cycles/op", "instr/op",
+                 "ipc", "misses/op", "ctxsw/op");
+    for (int op = 0; op < PERF_OP_COUNT; ++op) {
+        uint64_t n = stats[op].calls;
+        if (n == 0) continue;
+        char cols[PERF_EVENTS][16];
+        for (int i = 0; i < PERF_EVENTS; ++i) {
+            if (!available(i)) {
+                strcpy(cols[i], "n/a");
+            } else {
+                snprintf(cols[i], sizeof(cols[i]), "%.1f", (double)stats[op].sum[i] / n);
+            }
+        }
+        char ipc[16] = "n/a";
+        if (slot[0] >= 0 && slot[1] >= 0 && stats[op].sum[0] > 0) {
+            snprintf(ipc, sizeof(ipc), "%.2f", (double)stats[op].sum[1] / stats[op].sum[0]);
+        }
+        fs_important("perf: %-10s %8llu %12s %12s %6s %12s %12s\n", op_names[op], (unsigned long long)n,
+                     cols[0], cols[1], ipc, cols[2], cols[3]);
+    }
+}
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef PERF_H
+#define PERF_H
+
+// 每类 FUSE 回调的硬件性能计数器（周期、指令、缓存未命中、上下文切换）
+//
+// 只在 profiling 构建（make BUILD_TYPE=profile，定义 FSLAB_PERF）中编译进来，
+// 其他构建中 PERF_SCOPE 和 perf_report 都是空操作。
+// 计数器用 perf_event_open 只统计当前线程，在第一次使用时才打开（fuse_main 会 fork）；
+// 计数包括内核态；perf_event_paranoid 不允许时退回只统计用户态，上下文切换改用 getrusage。
+// 没有硬件 PMU 时，打不开的计数器输出 n/a
+
+typedef enum perf_op {
+    PERF_GETATTR,
+    PERF_READDIR,
+    PERF_READ,
+    PERF_MKNOD,
+    PERF_MKDIR,
+    PERF_UNLINK,
+    PERF_RMDIR,
+    PERF_RENAME,
+    PERF_WRITE,
+    PERF_TRUNCATE,
+    PERF_UTIMENS,
+    PERF_STATFS,
+    PERF_OPEN,
+    PERF_FLUSH,
+    PERF_RELEASE,
+    PERF_OPENDIR,
+    PERF_RELEASEDIR,
+    PERF_GETXATTR,
+    PERF_SETXATTR,
+    PERF_IOCTL,
+    PERF_OP_COUNT
+} perf_op_t;
+
+#ifdef FSLAB_PERF
+
+typedef struct perf_scope {
+    int op;     // -1 表示嵌套调用或计数器不可用，不统计
+} perf_scope_t;
+
+perf_scope_t perf_scope_begin(perf_op_t op);
+void perf_scope_end(perf_scope_t *scope);
+
+// 在回调开头使用，回调返回时自动结束统计
+#define PERF_SCOPE(op) \
+    perf_scope_t perf_scope_ __attribute__((cleanup(perf_scope_end))) = perf_scope_begin(op)
+
+// 输出每类回调的平均计数，卸载时调用
+void perf_report(void);
+
+#else
+
+#define PERF_SCOPE(op) ((void)0)
+#define perf_report() ((void)0)
+
+#endif
+
+#endif
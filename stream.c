@@ -0,0 +1,118 @@
+#include "stream.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+
+#include "disk.h"
+#include "heat.h"
+#include "logger.h"
+
+#define STREAM_SLOTS 2
+
+typedef struct chunk {
+    int n;
+    int blocks[STREAM_CHUNK_BLOCKS];
+    const char *data[STREAM_CHUNK_BLOCKS];
+    bool busy;
+} chunk_t;
+
+static chunk_t slots[STREAM_SLOTS];
+static int head;        // 写线程下一批要处理的槽
+static int tail;        // 下一次提交使用的槽
+static bool failed;
+static bool stopping;
+static bool running;
+static pthread_t worker;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t changed = PTHREAD_COND_INITIALIZER;
+
+static void *worker_main(void *arg) {
+    pthread_mutex_lock(&lock);
+    for (;;) {
+        while (!slots[head].busy && !stopping) {
+            pthread_cond_wait(&changed, &lock);
+        }
+        if (!slots[head].busy) break;
+        chunk_t *c = &slots[head];
+        pthread_mutex_unlock(&lock);
+
+        bool ok = true;
+        for (int i = 0; i < c->n; ++i) {
+            heat_write(c->blocks[i]);
+            if (disk_write(c->blocks[i], (void *)c->data[i]) != 0) ok = false;
+        }
+
+        pthread_mutex_lock(&lock);
+        if (!ok) failed = true;
+        c->busy = false;
+        head = (head + 1) % STREAM_SLOTS;
+        pthread_cond_broadcast(&changed);
+    }
+    pthread_mutex_unlock(&lock);
+    return NULL;
+}
+
+static bool start(void) {
+    if (running) return true;
+    stopping = false;
+    if (pthread_create(&worker, NULL, worker_main, NULL) != 0) {
+        fs_error("stream: create writer thread failed\n");
+        return false;
+    }
+    running = true;
+    return true;
+}
+
+void stream_submit(const int *blocks, const char *const *data, int n) {
+    if (!start()) {
+        // 写线程不可用时退化为同步写
+        for (int i = 0; i < n; ++i) {
+            heat_write(blocks[i]);
+            if (disk_write(blocks[i], (void *)data[i]) != 0) failed = true;
+        }
+        return;
+    }
+    pthread_mutex_lock(&lock);
+    while (slots[tail].busy) {
+        pthread_cond_wait(&changed, &lock);
+    }
+    chunk_t *c = &slots[tail];
+    c->n = n;
+    for (int i = 0; i < n; ++i) {
+        c->blocks[i] = blocks[i];
+        c->data[i] = data[i];
+    }
+    c->busy = true;
+    tail = (tail + 1) % STREAM_SLOTS;
+    pthread_cond_broadcast(&changed);
+    pthread_mutex_unlock(&lock);
+}
+
+int stream_wait(void) {
+    if (!running) {
+        int ret = failed ? -1 : 0;
+        failed = false;
+        return ret;
+    }
+    pthread_mutex_lock(&lock);
+    for (int i = 0; i < STREAM_SLOTS; ++i) {
+        while (slots[i].busy) {
+            pthread_cond_wait(&changed, &lock);
+        }
+    }
+    int ret = failed ? -1 : 0;
+    failed = false;
+    pthread_mutex_unlock(&lock);
+    return ret;
+}
+
+void stream_shutdown(void) {
+    if (!running) return;
+    stream_wait();
+    pthread_mutex_lock(&lock);
+    stopping = true;
+    pthread_cond_broadcast(&changed);
+    pthread_mutex_unlock(&lock);
+    pthread_join(worker, NULL);
+    running = false;
+}
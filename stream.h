@@ -0,0 +1,25 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+// 每批提交的块数
+#define STREAM_CHUNK_BLOCKS 8
+
+// 后台写线程，用于大块顺序写的流水线
+//
+// 调用者一边为下一批块做映射和分配，一边由写线程把上一批块写入磁盘，
+// 同时最多有两批在途（双缓冲），第三次提交会等待最早的一批完成。
+// 提交的数据指针在 stream_wait 返回之前必须保持有效。
+//
+// 写线程在第一次提交时才启动：fuse_main 在挂载之后会 fork 成守护进程，
+// 在 fs_mount 中创建的线程不会被带到子进程里
+
+// 提交一批整块写，blocks[i] 写入 data[i] 开始的 BLOCK_SIZE 字节，n 不超过 STREAM_CHUNK_BLOCKS
+void stream_submit(const int *blocks, const char *const *data, int n);
+
+// 等待所有已提交的写完成，全部成功返回 0，否则返回 -1
+int stream_wait(void);
+
+// 等待在途的写完成并停止写线程
+void stream_shutdown(void);
+
+#endif
@@ -0,0 +1,45 @@
+#!/bin/bash
+# 直接 I/O 对比测试：写入再读出共 MiB 兆字节的数据，输出吞吐和页缓存的增长。
+# 单个文件不能超过 MAX_FILE_SIZE（约 8 MiB），数据分散到每个 8 MiB 的多个文件中
+#
+# 用法：分别以两种方式挂载后运行，对比两次的输出
+#   make mount BUILD_TYPE=release && bash tests/bench/direct_io.sh [MiB]
+#   make mount BUILD_TYPE=release FUSE_OPTS="-o big_writes --direct-io" && bash tests/bench/direct_io.sh [MiB]
+# 块缓存被绕过的块数在卸载时的 "direct:" 日志中
+set -e
+
+MB=${1:-64}
+FILE_MB=8
+FILES=$(((MB + FILE_MB - 1) / FILE_MB))
+SRC=$(mktemp)
+trap 'rm -f "$SRC"' EXIT
+head -c $((MB << 20)) /dev/urandom > "$SRC"
+
+cached_kb() {
+	awk '/^Cached:/ { print $2 }' /proc/meminfo
+}
+
+rate() {
+	awk -v mb=$MB -v ns=$2 'BEGIN { printf "%-6s %d MiB: %8.2f MiB/s\n", "'"$1"'", mb, mb / (ns / 1e9) }'
+}
+
+cd mnt
+before=$(cached_kb)
+start=$(date +%s%N)
+for ((i = 0; i < FILES; i++)); do
+	dd if="$SRC" of=stream$i bs=1M skip=$((i * FILE_MB)) count=$FILE_MB status=none conv=fsync
+done
+end=$(date +%s%N)
+rate write $((end - start))
+
+start=$(date +%s%N)
+for ((i = 0; i < FILES; i++)); do
+	dd if=stream$i of=/dev/null bs=1M status=none
+done
+end=$(date +%s%N)
+rate read $((end - start))
+after=$(cached_kb)
+echo "page cache growth: $(((after - before) / 1024)) MiB"
+for ((i = 0; i < FILES; i++)); do
+	rm stream$i
+done
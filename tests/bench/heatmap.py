@@ -0,0 +1,73 @@
+"""渲染块访问热度图
+
+用法：
+    getfattr --only-values -n user.fslab.heatmap mnt | python3 tests/bench/heatmap.py
+    FSLAB_HEATMAP=$PWD/heat.txt make mount ... && make umount && python3 tests/bench/heatmap.py heat.txt
+
+输入格式见 heat.h。输出各分区（超级块、位图、inode 表、变更日志、数据区）的读写次数，
+按块号精确统计；动态 inode 格式（--dynamic-inodes）下 inode 表块分散在数据区中，计入 data。
+之后是整个设备的字符热度图，每个字符对应一个区域（默认 64 块）
+"""
+
+import sys
+from argparse import ArgumentParser
+
+SHADES = " .:-=+*#%@"
+
+parser = ArgumentParser()
+parser.add_argument("file", nargs="?", help="热度图文件，缺省时从标准输入读取")
+parser.add_argument("-w", "--width", type=int, default=64, help="每行的区域数")
+parser.add_argument(
+    "--writes", action="store_true", help="只看写（默认读写合计）"
+)
+parser.add_argument("--reads", action="store_true", help="只看读")
+args = parser.parse_args()
+
+text = open(args.file).read() if args.file else sys.stdin.read()
+lines = text.split("\n")
+header = lines[0].split()
+if len(header) != 3 or header[0] != "heatmap":
+    print("not a heat map")
+    exit(1)
+bucket, total = map(int, header[1:])
+buckets = total // bucket
+
+reads = [0] * buckets
+writes = [0] * buckets
+parts = []
+for line in lines[1:]:
+    fields = line.split()
+    if not fields:
+        continue
+    if fields[0] == "part":
+        name = fields[1].replace("_", " ")
+        parts.append((name, *map(int, fields[2:])))
+        continue
+    i, r, w = map(int, fields)
+    reads[i], writes[i] = r, w
+
+print(f"{'part':<12} {'blocks':>13} {'reads':>10} {'writes':>10}")
+for name, lo, hi, r, w in parts:
+    print(f"{name:<12} {f'{lo}-{hi - 1}':>13} {r:>10} {w:>10}")
+print()
+
+if args.reads:
+    heat = reads
+elif args.writes:
+    heat = writes
+else:
+    heat = [r + w for r, w in zip(reads, writes)]
+peak = max(heat) or 1
+# 分区的起始块所在的区域，没有访问时在图中用 | 标出
+boundaries = {lo // bucket for _, lo, _, _, _ in parts if lo > 0}
+
+print(f"each char = {bucket} blocks, '|' = part boundary, peak = {peak}")
+for row in range(0, buckets, args.width):
+    cells = []
+    for i in range(row, min(row + args.width, buckets)):
+        if heat[i] == 0:
+            c = SHADES[0]
+        else:
+            c = SHADES[1 + (heat[i] * (len(SHADES) - 2)) // peak]
+        cells.append("|" if i in boundaries and heat[i] == 0 else c)
+    print(f"{row * bucket:>6} {''.join(cells)}")
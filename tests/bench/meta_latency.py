@@ -0,0 +1,70 @@
+"""流式写入时元数据操作的尾延迟
+
+用法：make mount BUILD_TYPE=release && python3 tests/bench/meta_latency.py [--files N] [--mb M] [--streams K]
+
+先在 mnt/meta 下建立 N 个文件，分别在空闲时和后台 dd 持续写入时循环 stat 这些文件，
+输出两种情况下 stat 延迟的 p50 / p95 / p99 / max。单个文件不能超过 MAX_FILE_SIZE（约 8 MiB），
+所以后台轮流重写 K 个 M MiB 的文件，直到采样结束。卸载时日志中的 "cache: meta misses"
+一行给出文件系统内部元数据缺失的延迟分位数
+"""
+
+import os
+import random
+import signal
+import subprocess
+import time
+from argparse import ArgumentParser
+
+parser = ArgumentParser()
+parser.add_argument("--files", type=int, default=2000, help="number of files to stat")
+parser.add_argument("--mb", type=int, default=8, help="size of each streamed file, at most 8")
+parser.add_argument("--streams", type=int, default=4, help="number of files the writer rotates over")
+parser.add_argument("--samples", type=int, default=5000, help="stat calls per phase")
+args = parser.parse_args()
+# MAX_FILE_SIZE = (12 + 2 * 1024) * 4096 字节，再大的 dd 会以 EFBIG 提前结束
+if args.mb * 1024 * 1024 > (12 + 2 * 1024) * 4096:
+    parser.error("--mb must not exceed MAX_FILE_SIZE (8 MiB)")
+
+root = os.path.join("mnt", "meta")
+os.makedirs(root, exist_ok=True)
+names = [os.path.join(root, f"f{i}") for i in range(args.files)]
+for n in names:
+    open(n, "w").close()
+
+
+def sample(stop=None):
+    lat = []
+    while len(lat) < args.samples and (stop is None or stop.poll() is None):
+        n = random.choice(names)
+        start = time.perf_counter_ns()
+        os.stat(n)
+        lat.append(time.perf_counter_ns() - start)
+    return sorted(lat)
+
+
+def report(label, lat):
+    if not lat:
+        print(f"{label:<10} no samples")
+        return
+    pick = lambda q: lat[min(len(lat) - 1, int(q * len(lat)))] / 1000
+    print(
+        f"{label:<10} n={len(lat):<6} p50 {pick(0.5):9.1f} us  p95 {pick(0.95):9.1f} us  "
+        f"p99 {pick(0.99):9.1f} us  max {lat[-1] / 1000:9.1f} us"
+    )
+
+
+report("idle", sample())
+streams = [os.path.join("mnt", f"stream{i}") for i in range(args.streams)]
+# 轮流截断重写每个文件，写入持续到采样结束；dd 失败（比如磁盘满）时写入进程退出，采样随之停止
+writer = subprocess.Popen(
+    ["sh", "-c", 'while :; do for f in "$@"; do dd if=/dev/zero of="$f" bs=1M count=$0 status=none || exit 1; done; done',
+     str(args.mb), *streams],
+    start_new_session=True,
+)
+report("streaming", sample(writer))
+if writer.poll() is None:
+    os.killpg(writer.pid, signal.SIGTERM)
+writer.wait()
+for f in streams:
+    if os.path.exists(f):
+        os.remove(f)
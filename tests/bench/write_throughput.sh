@@ -0,0 +1,23 @@
+#!/bin/bash
+# 大块顺序写吞吐测试
+#
+# 用法：make mount BUILD_TYPE=release && bash tests/bench/write_throughput.sh [轮数]
+# 对 1/2/4/8 MiB 的单次写各重复若干轮，输出平均吞吐
+set -e
+
+ROUNDS=${1:-16}
+SRC=$(mktemp)
+trap 'rm -f "$SRC"' EXIT
+head -c $((8 << 20)) /dev/urandom > "$SRC"
+
+cd mnt
+for mb in 1 2 4 8; do
+	start=$(date +%s%N)
+	for ((i=0;i<ROUNDS;++i)); do
+		dd if="$SRC" of=bench_$mb bs=${mb}M count=1 status=none
+		rm bench_$mb
+	done
+	end=$(date +%s%N)
+	awk -v mb=$mb -v n=$ROUNDS -v ns=$((end - start)) \
+		'BEGIN { printf "%d MiB x %d: %8.2f MiB/s\n", mb, n, mb * n / (ns / 1e9) }'
+done
@@ -0,0 +1,533 @@
+// 内部一致性检查
+//
+// 和 microbench.c 一样直接包含 fs.c，磁盘换成 ramdisk.c 中的内存实现，在进程内反复格式化和重新挂载。
+// 覆盖通过 POSIX 调用看不到的部分：三种格式重新挂载后的内容、按目录树重新计算的 user.fslab.usage、
+// FSLAB_IOC_* 的往返、元数据块的校验和。用 make check 运行，有检查失败时返回非零
+
+#define FSLAB_MICROBENCH
+#include "fs.c"
+
+static int failures;
+
+#define CHECK(cond)                                                       \
+    do {                                                                  \
+        if (!(cond)) {                                                    \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);        \
+            failures++;                                                   \
+        }                                                                 \
+    } while (0)
+
+static bool mounted;
+
+// 按给定的格式重新格式化
+static void format(bool dynamic_inodes, bool change_log) {
+    if (mounted) fs_finalize(0);
+    format_dynamic_inodes = dynamic_inodes;
+    format_change_log = change_log;
+    CHECK(disk_mount(1) == 0);
+    CHECK(fs_mount(1) == 0);
+    mounted = true;
+}
+
+// 写回全部脏块后重新加载，之后的访问都从内存磁盘读起
+static void remount(void) {
+    CHECK(fs_finalize(0) == 0);
+    CHECK(disk_mount(0) == 0);
+    CHECK(fs_mount(0) == 0);
+}
+
+// ---- 文件内容 ----
+
+static char pattern_at(char seed, size_t i) {
+    return (char)(seed + i % 251);
+}
+
+static void put_file(const char *path, size_t offset, size_t size, char seed) {
+    static char buf[64 * 1024];
+    uint32_t ino;
+    if (find_inode_by_path(path, &ino) != 0) CHECK(fs_mknod(path, REGMODE, 0) == 0);
+    for (size_t done = 0; done < size;) {
+        size_t n = min(size - done, sizeof(buf));
+        for (size_t i = 0; i < n; ++i) buf[i] = pattern_at(seed, done + i);
+        CHECK(fs_write(path, buf, n, offset + done, NULL) == (int)n);
+        done += n;
+    }
+}
+
+static bool file_is(const char *path, size_t offset, size_t size, char seed) {
+    static char buf[64 * 1024];
+    for (size_t done = 0; done < size;) {
+        size_t n = min(size - done, sizeof(buf));
+        if (fs_read(path, buf, n, offset + done, NULL) != (int)n) return false;
+        for (size_t i = 0; i < n; ++i) {
+            if (buf[i] != pattern_at(seed, done + i)) return false;
+        }
+        done += n;
+    }
+    return true;
+}
+
+static uint32_t ino_of(const char *path) {
+    uint32_t ino = 0;
+    CHECK(find_inode_by_path(path, &ino) == 0);
+    return ino;
+}
+
+// ---- 子树统计和块计数 ----
+
+struct names {
+    int n, cap;
+    char (*name)[MAX_FILENAME_LEN + 1];
+};
+
+static int collect(void *buf, const char *name, const struct stat *st, off_t off) {
+    struct names *ns = buf;
+    if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) return 0;
+    if (ns->n == ns->cap) {
+        ns->cap = ns->cap ? ns->cap * 2 : 64;
+        ns->name = realloc(ns->name, ns->cap * sizeof(*ns->name));
+    }
+    snprintf(ns->name[ns->n++], MAX_FILENAME_LEN + 1, "%s", name);
+    return 0;
+}
+
+// 遍历目录树重新计算子树统计，并和每个目录 inode 中增量维护的值比较
+static void walk(const char *path, int64_t *bytes, int64_t *blocks, int64_t *files) {
+    inode_t node;
+    CHECK(read_inode(ino_of(path), &node) == 0);
+    *bytes = node.size;
+    *blocks = node.blocks;
+    *files = 1;
+    if (!S_ISDIR(node.mode)) return;
+    struct names ns = {0};
+    CHECK(fs_readdir(path, &ns, collect, 0, NULL) == 0);
+    for (int i = 0; i < ns.n; ++i) {
+        char child[1024];
+        snprintf(child, sizeof(child), "%s/%s", strcmp(path, "/") == 0 ? "" : path, ns.name[i]);
+        int64_t b, k, f;
+        walk(child, &b, &k, &f);
+        *bytes += b;
+        *blocks += k;
+        *files += f;
+    }
+    free(ns.name);
+
+    char text[96], expect[96];
+    int len = fs_getxattr(path, "user.fslab.usage", text, sizeof(text));
+    CHECK(len > 0);
+    snprintf(expect, sizeof(expect), "bytes=%lld blocks=%lld files=%lld", (long long)*bytes, (long long)*blocks,
+             (long long)*files);
+    if (len <= 0 || (size_t)len != strlen(expect) || memcmp(text, expect, len) != 0) {
+        printf("FAIL usage of %s: %.*s, walk gives %s\n", path, len > 0 ? len : 0, text, expect);
+        failures++;
+    }
+}
+
+static void check_usage(void) {
+    int64_t bytes, blocks, files;
+    walk("/", &bytes, &blocks, &files);
+}
+
+// 数据位图中已分配的块数
+static int64_t used_data_blocks(void) {
+    int64_t used = 0;
+    for (int i = 0; i < sb.num_data_blocks; i += BITMAP_BITS_PER_BLOCK) {
+        buf_t *bh = cache_get_meta(DATA_BITMAP_START_BLOCK + i / BITMAP_BITS_PER_BLOCK);
+        CHECK(bh != NULL);
+        if (bh == NULL) return -1;
+        int end = min(i + (int)BITMAP_BITS_PER_BLOCK, sb.num_data_blocks);
+        for (int j = i; j < end; ++j) {
+            int bit = j % BITMAP_BITS_PER_BLOCK;
+            used += (bh->data[bit / 8] >> (bit % 8)) & 1;
+        }
+        cache_put(bh);
+    }
+    return used;
+}
+
+// 位图中的块要么属于目录树（计入根目录的 tree_blocks），要么是动态格式下的 inode 表块
+static void check_block_count(void) {
+    inode_t root;
+    CHECK(read_inode(0, &root) == 0);
+    int64_t expect = root.tree_blocks;
+    if (sb.flags & SB_DYNAMIC_INODES) {
+        for (int t = 0; t < sb.inode_table_blocks; ++t) expect += inode_chunk_map[t] != 0;
+    }
+    int64_t used = used_data_blocks();
+    if (used != expect) {
+        printf("FAIL data bitmap has %lld blocks, tree and inode table account for %lld\n", (long long)used,
+               (long long)expect);
+        failures++;
+    }
+}
+
+// ---- 三种格式重新挂载后的内容 ----
+
+static void build_tree(void) {
+    CHECK(fs_mkdir("/a", DIRMODE) == 0);
+    CHECK(fs_mkdir("/a/b", DIRMODE) == 0);
+    put_file("/a/b/small", 0, 30000, 1);
+    put_file("/a/big", 0, 3 * 1024 * 1024, 2);  // 用到间接块
+    put_file("/a/sparse", 5 * 1024 * 1024, 10, 3);
+    CHECK(fs_mkdir("/many", DIRMODE) == 0);
+    char path[64];
+    for (int i = 0; i < 300; ++i) {
+        snprintf(path, sizeof(path), "/many/f%d", i);
+        put_file(path, 0, i * 7, (char)i);
+    }
+}
+
+static void check_tree(void) {
+    CHECK(file_is("/a/b/small", 0, 30000, 1));
+    CHECK(file_is("/a/big", 0, 3 * 1024 * 1024, 2));
+    CHECK(file_is("/a/sparse", 5 * 1024 * 1024, 10, 3));
+    char zeros[4096], buf[4096];
+    memset(zeros, 0, sizeof(zeros));
+    CHECK(fs_read("/a/sparse", buf, sizeof(buf), 4096, NULL) == sizeof(buf) && memcmp(buf, zeros, sizeof(buf)) == 0);
+    char path[64];
+    for (int i = 0; i < 300; ++i) {
+        snprintf(path, sizeof(path), "/many/f%d", i);
+        CHECK(file_is(path, 0, i * 7, (char)i));
+    }
+    check_usage();
+    check_block_count();
+}
+
+static void formats_suite(void) {
+    for (int f = 0; f < 4; ++f) {
+        bool dynamic = f & 1, change_log = f & 2;
+        format(dynamic, change_log);
+        build_tree();
+        check_tree();
+        remount();
+        CHECK(!!(sb.flags & SB_DYNAMIC_INODES) == dynamic);
+        CHECK(changelog_enabled() == change_log);
+        CHECK((sb.change_log_blocks > 0) == change_log);
+        check_tree();
+        // 重新挂载后继续修改，再挂载一次
+        put_file("/a/b/later", 0, 9000, 4);
+        CHECK(fs_unlink("/a/big") == 0);
+        remount();
+        CHECK(file_is("/a/b/later", 0, 9000, 4));
+        CHECK(find_inode_by_path("/a/big", &(uint32_t){0}) != 0);
+        check_usage();
+        check_block_count();
+    }
+    printf("formats: dynamic inodes and change log, each across two remounts\n");
+}
+
+// ---- 改名覆盖和删除的统计 ----
+
+static void accounting_suite(void) {
+    format(false, false);
+    CHECK(fs_mkdir("/d", DIRMODE) == 0);
+    CHECK(fs_mkdir("/e", DIRMODE) == 0);
+    put_file("/d/x", 0, 50000, 5);
+    put_file("/e/y", 0, 2 * 1024 * 1024, 6);
+    inode_t y;
+    CHECK(read_inode(ino_of("/e/y"), &y) == 0);
+    int64_t before = used_data_blocks();
+
+    // 跨目录改名覆盖：被覆盖的文件的块（包括间接块）全部释放
+    CHECK(fs_rename("/d/x", "/e/y") == 0);
+    CHECK(find_inode_by_path("/d/x", &(uint32_t){0}) != 0);
+    CHECK(file_is("/e/y", 0, 50000, 5));
+    CHECK(used_data_blocks() == before - y.blocks);
+    check_usage();
+    check_block_count();
+
+    // 目录改名到另一个目录下，子树统计随之移动
+    CHECK(fs_mkdir("/d/sub", DIRMODE) == 0);
+    put_file("/d/sub/z", 0, 70000, 7);
+    CHECK(fs_rename("/d/sub", "/e/sub") == 0);
+    check_usage();
+
+    CHECK(fs_unlink("/e/y") == 0);
+    CHECK(fs_unlink("/e/sub/z") == 0);
+    CHECK(fs_rmdir("/e/sub") == 0);
+    check_usage();
+    check_block_count();
+    remount();
+    check_usage();
+    check_block_count();
+    CHECK(fs_rmdir("/d") == 0);
+    CHECK(fs_rmdir("/e") == 0);
+    check_block_count();
+    inode_t root;
+    CHECK(read_inode(0, &root) == 0 && root.tree_files == 1);
+    printf("accounting: rename over a file and a directory, unlink, remount\n");
+}
+
+// ---- ioctl 往返 ----
+
+static int ioctl_on(const char *path, unsigned long cmd, void *data) {
+    return fs_ioctl(path, (int)cmd, NULL, NULL, 0, data);
+}
+
+static void extents_suite(void) {
+    static struct fslab_extent_query q;
+    put_file("/ext", 0, BLOCK_SIZE, 8);
+    put_file("/ext", 10 * BLOCK_SIZE, 100, 9);
+    q.start = 0;
+    q.length = UINT64_MAX;
+    CHECK(ioctl_on("/ext", FSLAB_IOC_EXTENTS, &q) == 0);
+    CHECK(q.count == 3);
+    if (q.count == 3) {
+        CHECK(q.extents[0].logical == 0 && q.extents[0].length == BLOCK_SIZE);
+        CHECK(!(q.extents[0].flags & FSLAB_EXTENT_HOLE));
+        CHECK(q.extents[0].physical >= (uint64_t)sb.data_blocks_start * BLOCK_SIZE);
+        CHECK(q.extents[1].logical == BLOCK_SIZE && (q.extents[1].flags & FSLAB_EXTENT_HOLE));
+        CHECK(q.extents[2].logical == 10 * BLOCK_SIZE && (q.extents[2].flags & FSLAB_EXTENT_LAST));
+        CHECK(q.extents[2].length == BLOCK_SIZE);  // 按块粒度返回
+    }
+    // 起点在文件末尾之后时没有区间
+    q.start = 20 * BLOCK_SIZE;
+    CHECK(ioctl_on("/ext", FSLAB_IOC_EXTENTS, &q) == 0 && q.count == 0);
+}
+
+static bool policy_is(const char *path, const char *text) {
+    char buf[96];
+    int len = fs_getxattr(path, "user.fslab.policy", buf, sizeof(buf));
+    return len == (int)strlen(text) && memcmp(buf, text, len) == 0;
+}
+
+static void policy_suite(void) {
+    uint32_t policy = FSLAB_POLICY_NOCACHE | FSLAB_POLICY_SEQUENTIAL;
+    CHECK(ioctl_on("/ext", FSLAB_IOC_SET_POLICY, &policy) == 0);
+    CHECK(policy_is("/ext", "nocache,sequential"));
+    const char *text = "writethrough,sync-on-close";
+    CHECK(fs_setxattr("/ext", "user.fslab.policy", text, strlen(text), 0) == 0);
+    CHECK(ioctl_on("/ext", FSLAB_IOC_GET_POLICY, &policy) == 0);
+    CHECK(policy == (FSLAB_POLICY_WRITETHROUGH | FSLAB_POLICY_SYNC_ON_CLOSE));
+    CHECK(fs_setxattr("/ext", "user.fslab.policy", "bogus", 5, 0) != 0);
+    policy = FSLAB_POLICY_WRITEBACK | FSLAB_POLICY_NOCACHE;
+    CHECK(ioctl_on("/ext", FSLAB_IOC_SET_POLICY, &policy) == -EINVAL);
+    // 目录上的策略被新建的文件继承
+    CHECK(fs_mkdir("/pol", DIRMODE) == 0);
+    CHECK(fs_setxattr("/pol", "user.fslab.policy", "sequential", 10, 0) == 0);
+    put_file("/pol/f", 0, 10, 1);
+    CHECK(policy_is("/pol/f", "sequential"));
+    remount();
+    CHECK(policy_is("/ext", "writethrough,sync-on-close"));
+    CHECK(policy_is("/pol/f", "sequential"));
+    CHECK(fs_setxattr("/ext", "user.fslab.policy", "", 0, 0) == 0 && policy_is("/ext", ""));
+}
+
+static void scan_suite(void) {
+    static struct fslab_inode_scan q;
+    CHECK(fs_mkdir("/scan", DIRMODE) == 0);
+    uint32_t dir = ino_of("/scan");
+    char path[64];
+    for (int i = 0; i < 600; ++i) {
+        snprintf(path, sizeof(path), "/scan/n%d", i);
+        put_file(path, 0, i, 0);
+    }
+    bool seen[600] = {false};
+    int found = 0, batches = 0;
+    q.next = 0;
+    do {
+        CHECK(ioctl_on("/", FSLAB_IOC_SCAN_INODES, &q) == 0);
+        for (uint32_t k = 0; k < q.count; ++k) {
+            if (q.inodes[k].parent != dir) continue;
+            CHECK(S_ISREG(q.inodes[k].mode) && q.inodes[k].size < 600 && !seen[q.inodes[k].size]);
+            if (q.inodes[k].size < 600) seen[q.inodes[k].size] = true;
+            found++;
+        }
+    } while (!(q.flags & FSLAB_SCAN_END) && ++batches < sb.num_inodes);
+    CHECK(found == 600);
+    CHECK(batches > 1);  // 结果超过一批，next 能正确续上
+}
+
+static void path_suite(void) {
+    static struct fslab_inode_path q;
+    CHECK(fs_mkdir("/p", DIRMODE) == 0);
+    CHECK(fs_mkdir("/p/q", DIRMODE) == 0);
+    put_file("/p/q/leaf", 0, 1, 0);
+    q.ino = ino_of("/p/q/leaf");
+    CHECK(ioctl_on("/", FSLAB_IOC_INODE_PATH, &q) == 0 && strcmp(q.path, "/p/q/leaf") == 0);
+    CHECK(fs_rename("/p/q", "/p/r") == 0);
+    CHECK(ioctl_on("/", FSLAB_IOC_INODE_PATH, &q) == 0 && strcmp(q.path, "/p/r/leaf") == 0);
+    CHECK(fs_unlink("/p/r/leaf") == 0);
+    CHECK(ioctl_on("/", FSLAB_IOC_INODE_PATH, &q) == -ENOENT);
+    q.ino = 0;
+    CHECK(ioctl_on("/", FSLAB_IOC_INODE_PATH, &q) == 0 && strcmp(q.path, "/") == 0);
+}
+
+static bool ranges_are(const char *path, const uint64_t (*expect)[2], uint32_t n) {
+    static struct fslab_range_query q;
+    q.start = 0;
+    q.length = UINT64_MAX;
+    if (ioctl_on(path, FSLAB_IOC_CHANGED_RANGES, &q) != 0 || q.count != n || q.flags != 0) return false;
+    for (uint32_t i = 0; i < n; ++i) {
+        if (q.ranges[i].offset != expect[i][0] || q.ranges[i].length != expect[i][1]) return false;
+    }
+    return true;
+}
+
+static void cbt_suite(void) {
+    static struct fslab_range_query q;
+    put_file("/cbt", 0, 10 * BLOCK_SIZE, 1);
+    q.start = 0;
+    q.length = UINT64_MAX;
+    CHECK(ioctl_on("/cbt", FSLAB_IOC_CHANGED_RANGES, &q) == 0 && (q.flags & FSLAB_RANGES_UNTRACKED));
+    CHECK(ioctl_on("/cbt", FSLAB_IOC_CHECKPOINT, NULL) == 0);
+    CHECK(ranges_are("/cbt", NULL, 0));
+    put_file("/cbt", 3 * BLOCK_SIZE + 5, 1, 2);
+    put_file("/cbt", 7 * BLOCK_SIZE, 2 * BLOCK_SIZE, 3);
+    const uint64_t after_write[][2] = {{3 * BLOCK_SIZE, BLOCK_SIZE}, {7 * BLOCK_SIZE, 2 * BLOCK_SIZE}};
+    CHECK(ranges_are("/cbt", after_write, 2));
+    // 检查点保存在磁盘上，重新挂载后仍然有效
+    remount();
+    CHECK(ranges_are("/cbt", after_write, 2));
+    // 截断涉及的块被记录，超过文件末尾的部分不返回
+    CHECK(fs_truncate("/cbt", 5 * BLOCK_SIZE) == 0);
+    CHECK(ranges_are("/cbt", after_write, 1));
+    CHECK(fs_truncate("/cbt", 6 * BLOCK_SIZE) == 0);
+    const uint64_t after_truncate[][2] = {{3 * BLOCK_SIZE, BLOCK_SIZE}, {5 * BLOCK_SIZE, BLOCK_SIZE}};
+    CHECK(ranges_are("/cbt", after_truncate, 2));
+    CHECK(ioctl_on("/cbt", FSLAB_IOC_CHECKPOINT, NULL) == 0);
+    CHECK(ranges_are("/cbt", NULL, 0));
+    CHECK(ioctl_on("/", FSLAB_IOC_CHECKPOINT, NULL) == -EISDIR);
+}
+
+// 读出 cursor 之后的所有记录
+static uint32_t read_changes(uint64_t *cursor, struct fslab_change *out, uint32_t max, uint32_t *flags) {
+    static struct fslab_change_query q;
+    uint32_t n = 0;
+    *flags = 0;
+    q.cursor = *cursor;
+    do {
+        CHECK(ioctl_on("/", FSLAB_IOC_READ_CHANGES, &q) == 0);
+        *flags |= q.flags;
+        for (uint32_t k = 0; k < q.count && n < max; ++k) out[n++] = q.changes[k];
+    } while (q.count == FSLAB_CHANGE_MAX);
+    *cursor = q.cursor;
+    return n;
+}
+
+static void changes_suite(void) {
+    static struct fslab_change c[FSLAB_CHANGE_MAX];
+    uint64_t cursor = 0;
+    uint32_t flags;
+    read_changes(&cursor, c, FSLAB_CHANGE_MAX, &flags);
+    CHECK(flags == 0);
+
+    CHECK(fs_mkdir("/cl", DIRMODE) == 0);
+    uint32_t dir = ino_of("/cl");
+    put_file("/cl/f", 0, 10, 1);
+    put_file("/cl/f", 10, 10, 1);  // 连续写入合并为一条
+    uint32_t ino = ino_of("/cl/f");
+    CHECK(fs_rename("/cl/f", "/g") == 0);
+    CHECK(fs_unlink("/g") == 0);
+    const uint32_t ops[][3] = {
+        {FSLAB_CHANGE_CREATE, 0, 0},           {FSLAB_CHANGE_CREATE, 1, 1},
+        {FSLAB_CHANGE_WRITE, 1, 1},            {FSLAB_CHANGE_RENAME_FROM, 1, 1},
+        {FSLAB_CHANGE_RENAME_TO, 1, 0},        {FSLAB_CHANGE_REMOVE, 1, 0},
+    };
+    uint32_t n = read_changes(&cursor, c, FSLAB_CHANGE_MAX, &flags);
+    CHECK(n == 6 && flags == 0);
+    for (uint32_t i = 0; i < n && i < 6; ++i) {
+        uint32_t want_ino = ops[i][1] ? ino : dir;
+        uint32_t want_parent = ops[i][2] ? dir : 0;
+        if (c[i].op != ops[i][0] || c[i].ino != want_ino || c[i].parent != want_parent || c[i].seq != c[0].seq + i) {
+            printf("FAIL change %u: op %u ino %u parent %u\n", i, c[i].op, c[i].ino, c[i].parent);
+            failures++;
+        }
+    }
+
+    // 重新挂载后序号接着增长，已经读过的记录不再返回
+    uint64_t head = cursor;
+    remount();
+    CHECK(read_changes(&cursor, c, FSLAB_CHANGE_MAX, &flags) == 0 && cursor == head);
+    put_file("/after", 0, 1, 0);
+    CHECK(read_changes(&cursor, c, FSLAB_CHANGE_MAX, &flags) == 2 && c[0].seq == head + 1);
+
+    // 不读取时写满环形缓冲区，读者必须得到 FSLAB_CHANGES_LOST
+    uint64_t capacity = (uint64_t)sb.change_log_blocks * ((BLOCK_SIZE - CHECKSUM_SIZE) / sizeof(struct fslab_change));
+    uint64_t stale = cursor;
+    for (uint64_t i = 0; i < capacity / 2 + 10; ++i) {
+        CHECK(fs_mknod("/churn", REGMODE, 0) == 0);
+        CHECK(fs_unlink("/churn") == 0);
+    }
+    static struct fslab_change_query q;
+    q.cursor = stale;
+    CHECK(ioctl_on("/", FSLAB_IOC_READ_CHANGES, &q) == 0);
+    CHECK(q.flags & FSLAB_CHANGES_LOST);
+    CHECK(q.count > 0 && q.changes[0].seq == q.head - capacity + 1);
+}
+
+static void ioctl_suite(void) {
+    format(false, false);
+    static struct fslab_change_query q;
+    CHECK(ioctl_on("/", FSLAB_IOC_READ_CHANGES, &q) == -EOPNOTSUPP);
+    CHECK(ioctl_on("/", _IO(FSLAB_IOC_MAGIC, 99), NULL) == -ENOTTY);
+    for (int f = 0; f < 2; ++f) {
+        format(f == 1, true);
+        extents_suite();
+        policy_suite();
+        scan_suite();
+        path_suite();
+        cbt_suite();
+        changes_suite();
+        check_usage();
+    }
+    printf("ioctl: extents, policy, scan, inode path, changed ranges, change log\n");
+}
+
+// ---- 校验和 ----
+
+// 直接改写磁盘上的一个字节，不更新校验和
+static void corrupt(int block, int offset) {
+    char buf[BLOCK_SIZE];
+    CHECK(disk_read(block, buf) == 0);
+    buf[offset] ^= 0x5a;
+    CHECK(disk_write(block, buf) == 0);
+}
+
+static void checksum_suite(void) {
+    format(false, false);
+    CHECK(fs_mkdir("/crc", DIRMODE) == 0);
+    put_file("/crc/f", 0, 100, 1);
+    uint32_t ino = ino_of("/crc/f");
+    remount();
+
+    // inode 表块损坏：这个块上的 inode 都读不出来，而不是返回错误的内容
+    uint64_t errors = cache_checksum_errors();
+    corrupt(inode_table_block(ino / INODES_PER_BLOCK), (ino % INODES_PER_BLOCK) * INODE_SIZE);
+    struct stat st;
+    CHECK(fs_getattr("/crc/f", &st) != 0);
+    CHECK(cache_checksum_errors() > errors);
+
+    // 位图块损坏：分配失败，不会重复分配已经占用的块（空的根目录需要一个数据块存放目录项）
+    format(false, false);
+    remount();
+    errors = cache_checksum_errors();
+    corrupt(DATA_BITMAP_START_BLOCK, 0);
+    CHECK(fs_mknod("/y", REGMODE, 0) != 0);
+    CHECK(cache_checksum_errors() > errors);
+
+    // 校验和覆盖整个块，包括末尾未使用的部分
+    format(false, false);
+    remount();
+    errors = cache_checksum_errors();
+    corrupt(SUPERBLOCK_BLOCK, BLOCK_SIZE - CHECKSUM_SIZE - 1);
+    CHECK(fs_finalize(0) == 0);
+    CHECK(disk_mount(0) == 0);
+    CHECK(fs_mount(0) != 0);
+    CHECK(cache_checksum_errors() > errors);
+    mounted = false;
+    printf("checksum: inode table, data bitmap and superblock corruption detected\n");
+}
+
+int main(void) {
+    formats_suite();
+    accounting_suite();
+    ioctl_suite();
+    checksum_suite();
+    if (failures > 0) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,231 @@
+// 内部函数的微基准测试
+//
+// 直接包含 fs.c 以调用内部函数，磁盘换成 ramdisk.c 中的内存实现，结果只反映 CPU 和缓存上的开销。
+// 每项测试重复 ROUNDS 轮，输出每轮 ns/op 的中位数。用 make microbench BUILD_TYPE=release 运行
+
+#define FSLAB_MICROBENCH
+#include "fs.c"
+
+#define ROUNDS 5
+
+static volatile uint64_t sink;  // 防止被测调用被优化掉
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint32_t rng(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)rng_state;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+typedef void (*bench_fn)(void *ctx, int iters);
+
+static void run(const char *name, const char *param, bench_fn fn, void *ctx, int iters) {
+    double ns[ROUNDS];
+    fn(ctx, iters / 10 + 1); // 预热
+    for (int r = 0; r < ROUNDS; ++r) {
+        uint64_t start = now_ns();
+        fn(ctx, iters);
+        ns[r] = (double)(now_ns() - start) / iters;
+    }
+    qsort(ns, ROUNDS, sizeof(double), cmp_double);
+    printf("%-26s %-14s %10.1f ns/op\n", name, param, ns[ROUNDS / 2]);
+}
+
+// ---- alloc_inode：不同占用率下分配并释放一个 inode ----
+
+static void bench_alloc_inode(void *ctx, int iters) {
+    for (int i = 0; i < iters; ++i) {
+        int ino = alloc_inode(0);
+        sink += ino;
+        if (ino >= 0) free_inode(ino);
+    }
+}
+
+static void alloc_suite(void) {
+    static int held[INODE_COUNT];
+    int n = 0;
+    const int levels[] = {0, 50, 90, 99};
+    for (size_t l = 0; l < sizeof(levels) / sizeof(levels[0]); ++l) {
+        while (n < INODE_COUNT * levels[l] / 100) {
+            int ino = alloc_inode(0);
+            if (ino < 0) break;
+            held[n++] = ino;
+        }
+        char param[32];
+        snprintf(param, sizeof(param), "%d%% full", levels[l]);
+        run("alloc_inode+free_inode", param, bench_alloc_inode, NULL, 20000);
+    }
+    while (n > 0) free_inode(held[--n]);
+}
+
+// ---- find_entry_in_directory：不同大小的目录中查找已有的条目 ----
+
+// 查找的文件名预先随机生成，计时循环中只有查找本身
+#define LOOKUP_NAMES 1024
+
+struct lookup_ctx {
+    inode_t dir;
+    char names[LOOKUP_NAMES][MAX_FILENAME_LEN + 1];
+};
+
+static void bench_find_entry(void *ctx, int iters) {
+    struct lookup_ctx *c = ctx;
+    for (int i = 0; i < iters; ++i) {
+        uint32_t ino = 0;
+        find_entry_in_directory(&c->dir, c->names[i % LOOKUP_NAMES], &ino);
+        sink += ino;
+    }
+}
+
+static void lookup_suite(void) {
+    const int sizes[] = {16, 128, 1024, 4096};
+    char path[64];
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        snprintf(path, sizeof(path), "/lookup%d", sizes[s]);
+        make_node(path, DIRMODE);
+        char *end = path + strlen(path);
+        for (int i = 0; i < sizes[s]; ++i) {
+            arena_reset();
+            snprintf(end, sizeof(path) - (end - path), "/f%d", i);
+            make_node(path, REGMODE);
+        }
+        *end = '\0';
+        arena_reset();
+        static struct lookup_ctx c;
+        for (int i = 0; i < LOOKUP_NAMES; ++i) {
+            snprintf(c.names[i], sizeof(c.names[i]), "f%u", rng() % sizes[s]);
+        }
+        uint32_t ino;
+        find_inode_by_path(path, &ino);
+        read_inode(ino, &c.dir);
+        char param[32];
+        snprintf(param, sizeof(param), "%d entries", sizes[s]);
+        run("find_entry_in_directory", param, bench_find_entry, &c, 20000);
+    }
+}
+
+// ---- find_inode_by_path：不同深度的路径解析 ----
+
+static void bench_path_walk(void *ctx, int iters) {
+    for (int i = 0; i < iters; ++i) {
+        uint32_t ino = 0;
+        arena_reset();
+        find_inode_by_path(ctx, &ino);
+        sink += ino;
+    }
+}
+
+static void path_suite(void) {
+    static char path[256];
+    const int depths[] = {1, 4, 16, 32};
+    int depth = 0;
+    for (size_t d = 0; d < sizeof(depths) / sizeof(depths[0]); ++d) {
+        while (depth < depths[d]) {
+            strcat(path, "/deep");
+            arena_reset();
+            make_node(path, DIRMODE);
+            depth++;
+        }
+        char param[32];
+        snprintf(param, sizeof(param), "depth %d", depths[d]);
+        run("find_inode_by_path", param, bench_path_walk, path, 20000);
+    }
+}
+
+// ---- read_inode / write_inode：随机访问已分配的 inode ----
+
+static void bench_read_inode(void *ctx, int iters) {
+    int span = *(int *)ctx;
+    inode_t node;
+    for (int i = 0; i < iters; ++i) {
+        if (read_inode(rng() % span, &node) == 0) sink += node.size;
+    }
+}
+
+static void bench_write_inode(void *ctx, int iters) {
+    int span = *(int *)ctx;
+    inode_t node;
+    for (int i = 0; i < iters; ++i) {
+        int ino = rng() % span;
+        if (read_inode(ino, &node) == 0) write_inode(ino, &node);
+    }
+}
+
+// lookup_suite 已经分配了这么多 inode
+#define INODE_SPAN 5000
+
+static void inode_suite(void) {
+    int span = INODE_SPAN;
+    run("read_inode", "random", bench_read_inode, &span, 200000);
+    run("read_inode+write_inode", "random", bench_write_inode, &span, 200000);
+}
+
+// ---- 块映射：逐块 get_block_num 和 extent 迭代器 ----
+
+// 单个文件最多的块数
+#define MAP_BLOCKS (DIRECT_POINTERS + INDIRECT_POINTERS * POINTERS_PER_BLOCK)
+
+static void bench_get_block_num(void *ctx, int iters) {
+    inode_t *node = ctx;
+    for (int i = 0; i < iters; ++i) {
+        sink += get_block_num(node, rng() % MAP_BLOCKS, false);
+    }
+}
+
+static void bench_iter_lookup(void *ctx, int iters) {
+    extent_iter_t it;
+    extent_iter_init(&it, ctx, 0, MAP_BLOCKS);
+    for (int i = 0; i < iters; ++i) {
+        sink += extent_iter_lookup(&it, i % MAP_BLOCKS);
+    }
+    extent_iter_done(&it);
+}
+
+static void bench_iter_extents(void *ctx, int iters) {
+    // 每次完整遍历 MAP_BLOCKS 个块，按块折算
+    for (int i = 0; i < iters; i += MAP_BLOCKS) {
+        extent_iter_t it;
+        extent_t ext;
+        extent_iter_init(&it, ctx, 0, MAP_BLOCKS);
+        while (extent_iter_next(&it, &ext)) sink += ext.length;
+        extent_iter_done(&it);
+    }
+}
+
+static void blockmap_suite(void) {
+    static inode_t node;
+    memset(&node, 0, sizeof(node));
+    node.mode = REGMODE;
+    for (int i = 0; i < MAP_BLOCKS; ++i) {
+        // 每隔一块留一个空洞，避免整个文件合并成一个 extent
+        if (i % 2 == 0) get_block_num(&node, i, true);
+    }
+    run("get_block_num", "random", bench_get_block_num, &node, 200000);
+    run("extent_iter_lookup", "sequential", bench_iter_lookup, &node, 200000);
+    run("extent_iter_next", "per block", bench_iter_extents, &node, 200 * MAP_BLOCKS);
+}
+
+int main(void) {
+    if (disk_mount(1) != 0 || fs_mount(1) != 0) {
+        fprintf(stderr, "microbench: mount failed\n");
+        return 1;
+    }
+    alloc_suite();
+    lookup_suite();
+    path_suite();
+    inode_suite();
+    blockmap_suite();
+    return 0;
+}
@@ -0,0 +1,30 @@
+// 微基准测试用的内存磁盘，接口和 disk.c 相同，不访问文件系统
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "disk.h"
+
+static char *ram;
+
+int disk_mount(int init_flag) {
+    if (ram == NULL) {
+        ram = calloc(BLOCK_NUM, BLOCK_SIZE);
+        if (ram == NULL) return 1;
+    } else if (init_flag) {
+        memset(ram, 0, (size_t)BLOCK_NUM * BLOCK_SIZE);
+    }
+    return 0;
+}
+
+int disk_read(int block_id, void* buffer) {
+    if (block_id >= BLOCK_NUM || block_id < 0) return 1;
+    memcpy(buffer, ram + (size_t)block_id * BLOCK_SIZE, BLOCK_SIZE);
+    return 0;
+}
+
+int disk_write(int block_id, void* buffer) {
+    if (block_id >= BLOCK_NUM || block_id < 0) return 1;
+    memcpy(ram + (size_t)block_id * BLOCK_SIZE, buffer, BLOCK_SIZE);
+    return 0;
+}
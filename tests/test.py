@@ -1,6 +1,10 @@
 import subprocess
 import os
 import os.path as osp
+import json
+import math
+import statistics
+import time
 from timeit import default_timer as timer
 from argparse import ArgumentParser
 
@@ -24,6 +28,29 @@ parser.add_argument(
     "--anwser", "--ans", action="store_true", help="generate answers only"
 )
 parser.add_argument("--release", action="store_true", help="release")
+parser.add_argument(
+    "--bench",
+    action="store_true",
+    help="benchmark mode: time each trace repeatedly on our filesystem, no answer comparison",
+)
+parser.add_argument("--reps", type=int, default=10, help="timed runs per trace")
+parser.add_argument(
+    "--warmup", type=int, default=2, help="untimed runs per trace before --reps"
+)
+parser.add_argument(
+    "--pin", type=str, help="CPU list for taskset, e.g. 2 or 2,3 (fuse and the trace)"
+)
+parser.add_argument(
+    "--cold",
+    action="store_true",
+    help="drop the page cache before every run (needs root)",
+)
+parser.add_argument(
+    "--bench-out",
+    type=str,
+    default="tests/bench/results.json",
+    help="JSON file results are merged into, keyed by git revision",
+)
 
 args = parser.parse_args()
 
@@ -143,6 +170,137 @@ def trace(i):
     return (passed, output_ref, output_stud, time_ref, time_stud)
 
 
+# ---- benchmark 模式 ----
+#
+# 每次运行都重新挂载（块缓存是冷的），先跑 --warmup 次不计时，再跑 --reps 次，
+# 输出中位数、p95 和均值的 95% 置信区间；结果按 git 版本合并到 --bench-out 中，
+# 便于比较不同提交的性能
+
+# 双侧 95% 的 t 分布分位数，自由度更大时用更小的一项，30 以上用正态近似
+T95 = {1: 12.706, 2: 4.303, 3: 3.182, 4: 2.776, 5: 2.571, 6: 2.447, 7: 2.365,
+       8: 2.306, 9: 2.262, 10: 2.228, 12: 2.179, 15: 2.131, 20: 2.086, 30: 2.042}
+
+
+def t95(df):
+    for k in sorted(T95, reverse=True):
+        if df >= k:
+            return T95[k]
+    return T95[1]
+
+
+def pinned(cmd):
+    return ["taskset", "-c", args.pin] + cmd if args.pin else cmd
+
+
+def drop_caches():
+    subprocess.run(["sync"], check=True)
+    with open("/proc/sys/vm/drop_caches", "w") as f:
+        f.write("3\n")
+
+
+def git_revision():
+    rev = subprocess.run(
+        ["git", "rev-parse", "HEAD"], capture_output=True, text=True
+    ).stdout.strip()
+    dirty = subprocess.run(
+        ["git", "status", "--porcelain", "--untracked-files=no"],
+        capture_output=True,
+        text=True,
+    ).stdout.strip()
+    return (rev or "unknown") + ("-dirty" if dirty else "")
+
+
+def bench_once(i):
+    """一次完整的运行（p 开头的 trace 包括重新挂载后的第二段），返回秒数，失败返回 None"""
+    phases = ["mount", "mount_noinit"] if i.startswith("p") else ["mount"]
+    elapsed = 0
+    for target in phases:
+        subprocess.run(
+            pinned(["make", target, f"BUILD_TYPE={build_type}"]),
+            check=True,
+            capture_output=not args.verbose,
+        )
+        if args.cold:
+            drop_caches()
+        start = timer()
+        result = subprocess.run(
+            pinned(["bash", osp.join(traces_folder, f"{i}.sh")]),
+            capture_output=not args.verbose,
+            text=True,
+            cwd=cwd,
+        )
+        elapsed += timer() - start
+        if result.returncode != 0:
+            print(f"Trace {i} failed with error code {result.returncode}")
+            print(result.stderr)
+            return None
+    subprocess.run(["make", "umount"], capture_output=not args.verbose)
+    return elapsed
+
+
+def summarize(samples):
+    ordered = sorted(samples)
+    n = len(ordered)
+    mean = statistics.mean(ordered)
+    stdev = statistics.stdev(ordered) if n > 1 else 0.0
+    half = t95(n - 1) * stdev / math.sqrt(n) if n > 1 else 0.0
+    return {
+        "samples": samples,
+        "median": statistics.median(ordered),
+        "p95": ordered[max(0, math.ceil(0.95 * n) - 1)],
+        "mean": mean,
+        "stdev": stdev,
+        "ci95": [mean - half, mean + half],
+    }
+
+
+def bench():
+    subprocess.run(["make", "clean"], check=True, capture_output=not args.verbose)
+    results = {}
+    for i in traces:
+        for _ in range(args.warmup):
+            if bench_once(i) is None:
+                break
+        samples = []
+        for _ in range(args.reps):
+            t = bench_once(i)
+            if t is None:
+                break
+            samples.append(t)
+        if len(samples) < args.reps or not samples:
+            print(f"Trace {i:2} skipped")
+            continue
+        r = summarize(samples)
+        results[i] = r
+        lo, hi = r["ci95"]
+        print(
+            f"Trace {i:2} median {r['median']:8.4f}s p95 {r['p95']:8.4f}s "
+            f"mean {r['mean']:8.4f}s [95% CI {lo:8.4f}, {hi:8.4f}] (n={len(samples)})"
+        )
+
+    history = {}
+    if osp.exists(args.bench_out):
+        with open(args.bench_out) as f:
+            history = json.load(f)
+    rev = git_revision()
+    entry = history.setdefault(rev, {"traces": {}})
+    entry.update(
+        {
+            "time": time.strftime("%Y-%m-%dT%H:%M:%S"),
+            "build": build_type,
+            "reps": args.reps,
+            "warmup": args.warmup,
+            "pin": args.pin,
+            "cold": args.cold,
+        }
+    )
+    entry["traces"].update(results)
+    os.makedirs(osp.dirname(args.bench_out) or ".", exist_ok=True)
+    with open(args.bench_out, "w") as f:
+        json.dump(history, f, indent=2, sort_keys=True)
+    print(f"Results for {rev} saved to {args.bench_out}")
+
+
 def main():
     subprocess.run(["make", "clean"], check=True, capture_output=not args.verbose)
     outputs = []
@@ -187,4 +345,7 @@ def main():
 
 
 if __name__ == "__main__":
-    main()
+    if args.bench:
+        bench()
+    else:
+        main()
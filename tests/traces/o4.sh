@@ -0,0 +1,41 @@
+#!/bin/bash
+set -e
+
+# 扩展属性 user.fslab.usage 和 user.fslab.policy：改名覆盖和删除之后子树统计随之变化，
+# 目录上的策略被新建的文件继承。原生文件系统上没有 user.fslab.usage，输出 unsupported
+
+cd mnt
+xattr() {
+	python3 - "$@" <<'PY'
+import os, sys
+op, path, name = sys.argv[1:4]
+try:
+    if op == "set":
+        os.setxattr(path, name, sys.argv[4].encode())
+    print(path, name, os.getxattr(path, name).decode())
+except OSError:
+    print(path, name, "unsupported")
+PY
+}
+
+mkdir -p tree/sub
+head -c 50000 /dev/zero > tree/a
+head -c 2000000 /dev/zero > tree/sub/b
+xattr get . user.fslab.usage
+xattr get tree user.fslab.usage
+xattr get tree/sub user.fslab.usage
+mv tree/a tree/sub/b
+xattr get tree user.fslab.usage
+xattr get tree/sub user.fslab.usage
+rm tree/sub/b
+xattr get tree user.fslab.usage
+rmdir tree/sub
+xattr get tree user.fslab.usage
+
+xattr set tree user.fslab.policy sequential,sync-on-close
+touch tree/c
+xattr get tree/c user.fslab.policy
+xattr set tree/c user.fslab.policy nocache
+echo hello > tree/c
+cat tree/c
+xattr get . user.fslab.usage
@@ -0,0 +1,27 @@
+#!/bin/bash
+set -e
+
+# 改名覆盖已有的文件、删除文件之后重新挂载，内容、大小和目录项应该保持不变
+
+cd mnt
+mkdir -p keep drop
+if [ -e keep/target ]; then
+	# 重新挂载后：检查上一次运行留下的结果
+	stat -c '%n %s' keep/target keep/big
+	tr -d 'a' < keep/target | wc -c
+	ls keep drop
+fi
+echo "old target" > keep/target
+head -c 300000 /dev/zero | tr '\0' 'a' > drop/source
+mv drop/source keep/target
+stat -c '%n %s' keep/target
+tr -d 'a' < keep/target | wc -c
+# 覆盖一个用到间接块的大文件
+head -c 3000000 /dev/zero | tr '\0' 'b' > keep/big
+echo "small" > drop/small
+mv drop/small keep/big
+cat keep/big
+head -c 3000000 /dev/zero | tr '\0' 'c' > keep/big
+head -c 70000 /dev/zero > drop/gone
+rm drop/gone
+ls keep drop